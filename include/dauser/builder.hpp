@@ -1,13 +1,138 @@
 #ifndef BUILDER_HPP
 #define BUILDER_HPP
 
+#include <mutex>
 #include <string>
 #include <vector>
+#include "config.hpp"
+#include "scheduler.hpp"
+
+// A single translation unit and the object file it compiles to. deps lists
+// inputs the depfile does not record, such as imported module interfaces.
+struct CompileUnit {
+    std::string source;
+    std::string object;
+    std::vector<std::string> flags;
+    std::vector<std::string> deps = {};
+};
+
+// Held by jobs while they print, so lines from parallel jobs do not interleave
+extern std::mutex compilation_mutex;
 
 // Utility to run a system command and print it
 int run_cmd(const std::string& cmd);
 
-// Build project with new version
-void build(std::string new_version);
+// Commands longer than this many characters pass their arguments in a response file
+const size_t response_file_threshold = 8000;
+
+// Shell command running program with args. Past response_file_threshold the
+// arguments go into rsp_dir/<hash>.rsp, named after its contents so an
+// unchanged file is never rewritten; an empty rsp_dir never uses one.
+std::string command_line(const std::string& program, const std::vector<std::string>& args,
+    const std::string& rsp_dir);
+
+// Extra "-x" option for sources g++ does not recognise by extension
+std::string language_flag(const std::string& source_file);
+
+// Add jobs compiling the stale units to graph. after[i] lists units that
+// must compile before unit i, such as the module interfaces it imports, and
+// makes unit i stale whenever one of them is. With batch_size > 1, stale
+// units sharing flags and an output directory are passed to a single
+// compiler invocation. Returns the job compiling each unit, or
+// JobGraph::none for units that are up to date.
+std::vector<size_t> add_compile_jobs(JobGraph& graph, const std::vector<CompileUnit>& units,
+    const std::string& compiler,
+    const std::vector<std::string>& includes,
+    int max_threads,
+    int batch_size,
+    const std::vector<std::vector<size_t>>& after = {}
+);
+
+// Compile units in parallel, skipping objects that are already up to date.
+// With batch_size > 1, stale units sharing flags and an output directory are
+// passed to a single compiler invocation. Returns one exit code per unit.
+std::vector<int> compile_all(const std::vector<CompileUnit>& units,
+    const std::string& compiler,
+    const std::vector<std::string>& includes,
+    int max_threads,
+    int batch_size
+);
+
+// Compiler used for a platform, or "" if the platform is not supported
+std::string platform_compiler(const std::string& platform, bool c);
+
+// Archiver used for static targets of a platform
+std::string platform_archiver(const std::string& platform);
+
+// What a build should produce; empty fields mean "as configured"
+struct BuildOptions {
+    std::string version;  // new version to record in project.json
+    std::string platform; // build only this platform
+    std::string variant;  // entry of "variants" to build
+    std::string target;   // entry of "targets" to build, with its dependencies
+};
+
+// Compiler flags of every object of a target for a platform and variant:
+// the variant's flags, then those its LTO, profile, split DWARF and
+// function order settings need. check uses them too, so both compile alike.
+std::vector<std::string> target_flags(const json& settings, const std::string& variant,
+    const std::string& platform, const std::string& compiler, const std::string& buildpath);
+
+// Path of the binary build() produces for a platform and variant
+std::string output_path(const json& config, const std::string& platform, const std::string& version,
+    const std::string& variant = "");
+
+// Jobs of one target on one platform, reported once the graph has run
+struct BuildOutcome {
+    std::string label;
+    std::vector<size_t> compile_jobs;
+    std::vector<size_t> dependency_jobs;
+    size_t link_job;
+};
+
+// A library a dependent links, and the file whose timestamp tells the
+// dependent to relink: the interface stamp for shared libraries. Archives
+// are linked like objects, never searched for at run time.
+struct LinkedLibrary {
+    std::string path;
+    std::string stamp;
+    bool archive = false;
+};
+
+// Link of a planned target that other targets can wait for and link against
+struct PlannedLink {
+    std::string platform;
+    std::string output;
+    std::string type;                     // "elf", "shared" or "static"
+    size_t job;
+    std::vector<LinkedLibrary> libraries; // what a dependent links: the library and, for
+                                          // static ones, the libraries it needs itself
+};
+
+// Jobs of one or more projects, run together under one thread budget
+struct BuildPlan {
+    JobGraph graph;
+    std::vector<BuildOutcome> outcomes;
+    bool ok = true; // false once a target could not be planned
+};
+
+// Add the jobs building a project's targets to plan. project prefixes its
+// messages in a workspace. Every target also waits for the links in
+// external and links in their shared libraries. Returns the planned links.
+std::vector<PlannedLink> plan_project(BuildPlan& plan, const json& config, const BuildOptions& options,
+    const std::string& version, const std::string& project = "", const std::vector<PlannedLink>& external = {});
+
+// Run the jobs of a plan on up to max_threads threads and report what
+// failed. Returns false if anything failed.
+bool run_plan(BuildPlan& plan, int max_threads);
+
+// Build the targets and platforms of options from a loaded config, which
+// may carry variants of its own; project.json is left alone. outputs
+// receives every file the build links. Returns false if anything failed.
+bool build_config(const json& config, const BuildOptions& options, std::vector<std::string>& outputs);
+
+// Build the project. The compiles and links of every requested target and
+// platform run in one job graph. Returns false if anything failed.
+bool build(BuildOptions options);
 
 #endif // BUILDER_HPP
@@ -0,0 +1,28 @@
+#ifndef BUILDLOCK_HPP
+#define BUILDLOCK_HPP
+
+#include <string>
+#include <vector>
+
+#include "builder.hpp"
+
+// Run build() while holding the build lock of the variant's directory. If
+// another jmakepp process is already building the same request, wait for it
+// and return its result instead of compiling the same objects a second time.
+bool coalesced_build(const BuildOptions& options);
+
+// Build locks of several variant directories, held until destroyed, for
+// builds that write to more than one project at a time. The locks are taken
+// in path order, so two builds locking overlapping sets cannot deadlock.
+class BuildLocks {
+public:
+    explicit BuildLocks(const std::vector<std::string>& buildpaths);
+    ~BuildLocks();
+    BuildLocks(const BuildLocks&) = delete;
+    BuildLocks& operator=(const BuildLocks&) = delete;
+
+private:
+    std::vector<int> fds;
+};
+
+#endif // BUILDLOCK_HPP
@@ -0,0 +1,11 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <string>
+
+// Check a single file for the host platform and default variant with the
+// flags and include paths build() would use, without linking or touching other sources.
+// With object, the file's object is compiled instead of -fsyntax-only.
+int check_file(const std::string& file, bool object);
+
+#endif // CHECK_HPP
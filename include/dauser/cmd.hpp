@@ -1,3 +1,22 @@
+#ifndef CMD_HPP
+#define CMD_HPP
+
 #include <iostream>
 #include <string>
+#include <vector>
+
 int run_cmd(const std::string& cmd);
+
+// Run a command and collect its standard output. Returns the exit code.
+int capture_cmd(const std::string& cmd, std::string& output);
+
+// Replace the current process with program (no shell), passing args and
+// the inherited stdin/stdout/stderr. Returns the program's exit code where
+// the process cannot be replaced (Windows), or 127 if it fails to start.
+int exec_program(const std::string& program, const std::vector<std::string>& args);
+
+// Run program (no shell) with args like exec_program, but wait for it
+// instead of replacing the current process. Returns its exit code.
+int run_program(const std::string& program, const std::vector<std::string>& args);
+
+#endif // CMD_HPP
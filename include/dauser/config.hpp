@@ -7,8 +7,55 @@
 
 using json = nlohmann::json;
 
-// Load JSON config from file
-json load_project_config();
+// Load JSON config from file, dir/project.json when dir is given
+json load_project_config(const std::string& dir = "");
+
+// A project's config with every path it names made relative to the
+// directory holding dir, so the project can be built from there. Paths
+// inside flags are left alone.
+json rebase_config(json config, const std::string& dir);
+
+// Source files listed in srcpath (a string or an array)
+std::vector<std::string> project_sources(const json& config);
+
+// Arguments in a field holding a whitespace separated string or an array
+std::vector<std::string> config_arguments(const json& config, const std::string& key);
+
+// Compiler flags from "flags" (a whitespace separated string or an array)
+std::vector<std::string> project_flags(const json& config);
+
+// Variant to build: the requested one, else "variant" from project.json,
+// else "" for the plain configuration. Throws for unknown variants.
+std::string selected_variant(const json& config, const std::string& requested);
+
+// Directory a variant keeps its objects and outputs in: buildpath itself
+// for the plain configuration, buildpath/<variant>/ otherwise
+std::string variant_buildpath(const json& config, const std::string& variant);
+
+// A field of a variant, else the same field of config, else fallback
+json variant_value(const json& config, const std::string& variant, const std::string& key, const json& fallback);
+
+// Add a variant to config, and to the targets that have "variants" of their own
+void add_variant(json& config, const std::string& name, const json& variant);
+
+// Compiler flags for a variant: "flags" followed by the variant's own flags.
+// Throws when config has no such variant.
+std::vector<std::string> variant_flags(const json& config, const std::string& variant);
+
+// Names of the entries in "targets", or {""} for a project that builds a
+// single output from its top level settings
+std::vector<std::string> project_targets(const json& config);
+
+// Settings of one target: the project's settings overridden by the target's
+// own, with its "flags" and "includepaths" added to the project's
+json target_config(const json& config, const std::string& target);
+
+// Targets to build for a request, each after the targets in its "depends".
+// Empty requests every target. Throws for unknown targets and cycles.
+std::vector<std::string> target_build_order(const json& config, const std::string& requested);
+
+// Target "jmakepp run" starts: the requested one, else the only elf target
+std::string run_target(const json& config, const std::string& requested);
 
 // Expand wildcard include paths (supports simple * wildcard)
 std::vector<std::string> expand_includes(const std::vector<std::string>& raw);
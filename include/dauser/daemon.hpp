@@ -0,0 +1,18 @@
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#include <string>
+#include "builder.hpp"
+
+// Serve builds for the project in the current directory over a Unix socket,
+// keeping config, depfiles and file state in memory between requests
+int run_daemon();
+
+// Daemon request that runs a build with the given options
+std::string build_request(const BuildOptions& options);
+
+// Forward a request to the project's daemon and stream back its output.
+// Returns false when no daemon is running.
+bool daemon_request(const std::string& request, int& exit_code);
+
+#endif // DAEMON_HPP
@@ -0,0 +1,27 @@
+#ifndef DEPS_HPP
+#define DEPS_HPP
+
+#include <string>
+#include <vector>
+
+// Read the prerequisites listed in a make-style depfile (as written by -MMD)
+std::vector<std::string> read_depfile(const std::string& depfile);
+
+// Check whether an object is newer than its source, every header recorded
+// in its depfile and any extra_deps, and was compiled with the same command
+// signature. A missing extra dependency always makes the object stale.
+bool object_up_to_date(const std::string& obj_file, const std::string& signature,
+    const std::vector<std::string>& extra_deps = {});
+
+// Check whether a linked output is newer than all of its inputs and was
+// produced by the same command, recorded next to stamp
+bool output_up_to_date(const std::string& output, const std::string& stamp,
+    const std::string& signature, const std::vector<std::string>& inputs);
+
+// Short stable hash of some text (64-bit FNV-1a, in hex)
+std::string content_hash(const std::string& text);
+
+// Record the command signature an object was compiled with
+void write_signature(const std::string& obj_file, const std::string& signature);
+
+#endif // DEPS_HPP
@@ -0,0 +1,32 @@
+#ifndef DEPSCAN_HPP
+#define DEPSCAN_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Finds #include dependencies without running the compiler. Quoted includes
+// are resolved next to the including file first, then against the -I list;
+// headers that cannot be resolved (system headers) are skipped, like -MMD.
+class IncludeScanner {
+public:
+    // includes are "-I<dir>" flags as returned by expand_includes()
+    explicit IncludeScanner(const std::vector<std::string>& includes);
+
+    // Headers a file includes directly, outside comments and #if 0 regions
+    const std::vector<std::string>& direct(const std::string& file);
+
+    // Every header reachable from a source, in discovery order
+    std::vector<std::string> dependencies(const std::string& source);
+
+private:
+    std::vector<std::string> dirs;
+    std::map<std::string, std::vector<std::string>> cache;
+
+    std::string resolve(const std::string& name, bool quoted, const std::string& from) const;
+};
+
+// Print the sources in project.json that depend on any of the given files
+void show_affected(const std::vector<std::string>& changed);
+
+#endif // DEPSCAN_HPP
@@ -0,0 +1,45 @@
+#ifndef FILECACHE_HPP
+#define FILECACHE_HPP
+
+#include <filesystem>
+#include <functional>
+#include <string>
+
+// In-memory snapshots of file state kept between builds. The cache is off
+// unless the build daemon enables it; the daemon then drops entries as
+// inotify reports changes. With the cache off every call goes to the disk.
+
+// Turn the cache on. watch is called once for every directory whose files
+// get cached, before the first lookup, so no change can be missed. Files in
+// directories it returns false for (e.g. not created yet) are not cached.
+// sync applies the changes reported so far.
+void enable_file_cache(std::function<bool(const std::string&)> watch, std::function<void()> sync);
+
+bool file_cache_enabled();
+
+// Apply pending change notifications. The builder calls this after it
+// wrote files itself, e.g. once a round of compiles finished.
+void sync_file_cache();
+
+// Modification time of a file; false if it does not exist
+bool file_mtime(const std::string& path, std::filesystem::file_time_type& time);
+
+// Contents of a file; false if it cannot be read
+bool read_file_cached(const std::string& path, std::string& contents);
+
+// Make sure changes inside a directory are reported to the cache
+void watch_directory(const std::string& dir);
+
+// Forget what is known about a path after it changed on disk
+void invalidate_file(const std::string& path);
+
+// Forget everything, including which directories are watched, e.g. after
+// inotify dropped events or a watched directory went away
+void invalidate_file_cache();
+
+// Incremented whenever directories are created or removed, so directory
+// listings derived from the disk know when to be recomputed
+unsigned long directory_generation();
+void bump_directory_generation();
+
+#endif // FILECACHE_HPP
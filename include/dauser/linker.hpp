@@ -0,0 +1,71 @@
+#ifndef LINKER_HPP
+#define LINKER_HPP
+
+#include <string>
+#include <vector>
+#include "config.hpp"
+
+// Whether compiler is clang, whose LTO and profile flags differ from g++'s
+bool is_clang(const std::string& compiler);
+
+// Linker a platform's links use: "linker" from project.json (one name, or
+// an object with one per platform), else the fastest of mold, lld and gold
+// that the compiler accepts. "default" leaves the choice to the compiler.
+// Probe results are cached in buildpath until the next clean.
+std::string select_linker(const json& config, const std::string& platform, const std::string& compiler);
+
+// Flags that make the compiler driver link with linker on threads threads
+std::vector<std::string> linker_flags(const std::string& linker, int threads);
+
+// Threads a link with linker_flags(linker, threads) keeps busy, which the
+// scheduler reserves for it
+int linker_weight(const std::string& linker, int threads);
+
+// Link threads when "link threads" is not set: a quarter of max_threads, so
+// a link starts while other targets still compile, and 1 for gold, which
+// gains little from more
+int default_link_threads(const std::string& linker, int max_threads);
+
+// LTO mode of a target: "full", "thin" or "" for none, from "lto" (true
+// means "full"). A variant's own "lto" takes precedence.
+std::string lto_mode(const json& settings, const std::string& variant);
+
+// Compile flags for an LTO mode. g++ has no ThinLTO; its "-flto" already
+// splits the link into parallel partitions.
+std::vector<std::string> lto_compile_flags(const std::string& mode, const std::string& compiler);
+
+// Link flags that run the LTO backend on jobs threads, keeping ThinLTO
+// results in cache_dir
+std::vector<std::string> lto_link_flags(const std::string& mode, const std::string& compiler,
+    const std::string& linker, const std::string& platform, int jobs, const std::string& cache_dir);
+
+// Threads an LTO link keeps busy, which the scheduler reserves for it
+int lto_link_weight(const std::string& mode, const std::string& compiler, int jobs);
+
+// Archiver that writes the symbol index of LTO objects
+std::string lto_archiver(const std::string& platform, const std::string& compiler);
+
+// Profile a variant's functions are ordered by: its "function order" field,
+// else the project's, or "" when neither sets one
+std::string function_order_profile(const json& settings, const std::string& variant);
+
+// Functions of a profile, hottest first. profile is a perf.data file (read
+// with perf script) or text with one "[count] symbol" sample per line.
+std::vector<std::string> hot_functions(const std::string& profile);
+
+// Link flags placing the functions of profile first, in order_file, which
+// is rewritten only when the order changes. Objects must be compiled with
+// -ffunction-sections. Empty when there is no profile or the linker
+// cannot order sections.
+std::vector<std::string> function_order_flags(const std::string& profile, const std::string& linker,
+    const std::string& platform, const std::string& order_file);
+
+// Debug info of a linked Linux output, once it is linked: with
+// package_dwo the split DWARF (.dwo) of its objects is packed into
+// output.dwp; with separate the debug sections move to a compressed
+// output.debug that output names in .gnu_debuglink. Skipped while output
+// is unchanged since the last run, recorded next to stamp. Returns the
+// exit code.
+int separate_debug_info(const std::string& output, const std::string& stamp, bool package_dwo, bool separate);
+
+#endif // LINKER_HPP
@@ -0,0 +1,29 @@
+#ifndef MODULES_HPP
+#define MODULES_HPP
+
+#include <string>
+#include <vector>
+#include "builder.hpp"
+
+// Module declarations found in a source file
+struct ModuleInfo {
+    std::string provides;             // "name" or "name:partition", empty if none
+    std::vector<std::string> imports; // named modules and partitions imported
+};
+
+// Scan a source for its module declaration and imports without running the compiler
+ModuleInfo scan_module_source(const std::string& source_file);
+
+// Flags every unit of a module build needs to find the cached interfaces
+std::vector<std::string> module_flags(const std::string& build_dir);
+
+// Prepare units that use C++20 modules for compilation: add the module
+// flags, write the mapper and fill after[i] with the units providing the
+// interfaces unit i imports, which must compile first. Built module
+// interfaces are kept in build_dir/gcm.cache so they are reused across
+// builds. Returns false for duplicate modules and import cycles.
+bool prepare_modules(std::vector<CompileUnit>& units, const std::string& compiler,
+    const std::string& build_dir, std::vector<std::vector<size_t>>& after
+);
+
+#endif // MODULES_HPP
@@ -0,0 +1,35 @@
+#ifndef MULTIARCH_HPP
+#define MULTIARCH_HPP
+
+#include <string>
+#include <vector>
+#include "config.hpp"
+
+// Levels (x86-64-v2, -v3, -v4) the sources in "multiarch" are compiled for
+// besides the baseline: "multiarch levels", by default all three. Empty
+// when the target has no multiarch sources. Throws for unknown levels.
+std::vector<std::string> multiarch_levels(const json& settings);
+
+// Whether source is listed in "multiarch"
+bool is_multiarch_source(const json& settings, const std::string& source);
+
+// Object the build of a unit for level goes to
+std::string level_object(const std::string& object, const std::string& level);
+
+// What the link reads in place of a multiarch unit's object. first holds
+// the dispatcher and the baseline build; last holds the level builds,
+// which must follow every other object so that inline and template code
+// shared with other units keeps its baseline build.
+struct MultiarchObjects {
+    std::vector<std::string> first;
+    std::vector<std::string> last;
+};
+MultiarchObjects multiarch_objects(const std::string& object, const std::vector<std::string>& levels);
+
+// Give the functions of object and of its level builds names of their
+// own, and compile a dispatcher that binds the original names to the best
+// build for the CPU when the program loads (GNU ifunc). Skipped when the
+// objects have not changed. Returns the exit code.
+int build_multiarch(const std::string& object, const std::vector<std::string>& levels, const std::string& compiler);
+
+#endif // MULTIARCH_HPP
@@ -0,0 +1,40 @@
+#ifndef PCH_HPP
+#define PCH_HPP
+
+#include <string>
+#include <vector>
+#include "builder.hpp"
+
+// Headers included by at least threshold (0..1) of the units, most
+// frequently included first. Depfiles are used where a previous build left
+// them, otherwise the include scanner predicts the dependencies. The
+// depfile of a unit compiled with pch_header leaves out the precompiled
+// headers, so those are taken from the depfile of its .gch.
+std::vector<std::string> hot_headers(const std::vector<CompileUnit>& units,
+    const std::vector<std::string>& includes,
+    double threshold,
+    const std::string& pch_header = ""
+);
+
+// Build (or reuse) a precompiled header for the given compile settings.
+// pch is either a header path or "auto" to pick headers with hot_headers().
+// Returns the absolute header path to pass with -include, or "" when no PCH
+// is available.
+std::string prepare_pch(const std::string& pch,
+    const std::vector<CompileUnit>& units,
+    const std::string& compiler,
+    const std::vector<std::string>& flags,
+    const std::vector<std::string>& includes,
+    const std::string& build_dir,
+    bool c,
+    double threshold
+);
+
+// Flags that make a compile use the header returned by prepare_pch()
+std::vector<std::string> pch_flags(const std::string& pch_header);
+
+// Make unit use the header returned by prepare_pch(). Its .gch becomes a
+// dependency, so a rebuilt PCH recompiles the unit.
+void use_pch(CompileUnit& unit, const std::string& pch_header);
+
+#endif // PCH_HPP
@@ -0,0 +1,26 @@
+#ifndef PGO_HPP
+#define PGO_HPP
+
+#include <string>
+#include <vector>
+#include "config.hpp"
+
+// Compiler flags for a variant's "profile generate" (directory the
+// instrumented binaries write their profile to) or "profile use"
+// (directory of a merged profile). Objects are named relative to
+// buildpath in the profile, so variants with different buildpaths agree.
+std::vector<std::string> profile_flags(const json& settings, const std::string& variant,
+    const std::string& compiler, const std::string& buildpath);
+
+// Profile data an object of a "profile use" variant is optimized with, or ""
+// when there is none. A new profile recompiles the object.
+std::string profile_dependency(const json& settings, const std::string& variant,
+    const std::string& compiler, const std::string& buildpath, const std::string& object);
+
+// Profile-guided build of the host binary: build the target instrumented,
+// run it with args (else "pgo train" from project.json), merge the profile
+// and rebuild the target optimized with it. Each stage is skipped when up
+// to date. Returns false if any stage failed.
+bool run_pgo(const std::string& target, const std::string& variant, const std::vector<std::string>& args);
+
+#endif // PGO_HPP
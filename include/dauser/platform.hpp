@@ -9,4 +9,11 @@
 #else
     inline bool is_windows = false;
     inline bool is_macos = false;
-#endif
\ No newline at end of file
+#endif
+
+#include <string>
+
+// Name of the platform jmakepp is running on, as used in "platforms"
+inline std::string host_platform() {
+    return is_windows ? "windows" : is_macos ? "macos" : "linux";
+}
@@ -0,0 +1,36 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Build steps and the order they must run in. Compiles and links of every
+// target share one graph, so a link starts as soon as its own inputs are
+// ready instead of waiting for unrelated compiles.
+class JobGraph {
+public:
+    // Returned instead of a job id when there is nothing to run
+    static const size_t none = static_cast<size_t>(-1);
+
+    // Add a job that runs once every job in after has succeeded. weight is
+    // the number of threads the job keeps busy itself, such as a parallel
+    // LTO link; it runs only when that many are free. Ready jobs start in
+    // the order they were added, so later jobs wait while a heavy job waits
+    // for threads. Returns its id.
+    size_t add(std::function<int()> job, const std::vector<size_t>& after = {}, int weight = 1);
+
+    // Number of jobs added so far
+    size_t size() const;
+
+    // Run all jobs on up to max_threads threads and return one exit code per
+    // job. Jobs whose prerequisites failed are not run and report 1.
+    std::vector<int> run(int max_threads);
+
+private:
+    std::vector<std::function<int()>> jobs;
+    std::vector<std::vector<size_t>> prerequisites;
+    std::vector<int> weights;
+};
+
+#endif // SCHEDULER_HPP
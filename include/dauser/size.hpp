@@ -0,0 +1,26 @@
+#ifndef SIZE_HPP
+#define SIZE_HPP
+
+#include <string>
+#include <vector>
+#include "config.hpp"
+
+// Directory size reports are kept in: "size report" (true means
+// ./sizes/), or "" when reports are off
+std::string size_report_dir(const json& settings);
+
+// Record the section sizes, largest symbols and per-object sizes of a
+// linked output in dir/<output file name>[.<variant>]@<version>.json, with
+// the fields of info (target, platform, version, variant). Skipped while the report is newer
+// than output. Returns false, after a warning, when output could not be read
+// or the report could not be written; it never throws, since it runs as a job.
+bool record_size_report(const std::string& output, const std::vector<std::string>& objects,
+    const std::string& platform, const std::string& dir, const json& info);
+
+// Print the size report of the targets' outputs for version, or with
+// other_version given, what changed from version to other_version.
+// Empty versions mean the current one. Returns false if a report is missing.
+bool show_size(const std::string& version, const std::string& other_version, const std::string& target,
+    const std::string& platform, const std::string& variant);
+
+#endif // SIZE_HPP
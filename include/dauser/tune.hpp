@@ -0,0 +1,15 @@
+#ifndef TUNE_HPP
+#define TUNE_HPP
+
+#include <string>
+#include <vector>
+
+// Build the host binary under each candidate of "tune candidates" (each a
+// variant of its own, so objects are kept between runs), time runs of
+// it with args (else "tune benchmark") runs times (0 for "tune runs") and
+// report the fastest with 95% confidence intervals. With write, the winner is stored in project.json
+// as the "tuned" variant and made the default. Returns false if no
+// candidate could be measured.
+bool run_tune(const std::string& target, int runs, bool write, const std::vector<std::string>& args);
+
+#endif // TUNE_HPP
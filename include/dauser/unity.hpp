@@ -0,0 +1,37 @@
+#ifndef UNITY_HPP
+#define UNITY_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "builder.hpp"
+
+// What a source declares at namespace scope that could clash with the
+// sources a unity file merges it with, names qualified by their namespace
+struct SourceNames {
+    std::set<std::string> internal;               // statics, anonymous namespace members, const
+                                                  // variables, class types and enumerators
+    std::set<std::string> external;               // other declarations and using-declarations
+    std::map<std::string, std::string> aliases;   // typedefs and aliases, with what they name
+    std::set<std::string> macros;                 // macros still defined at the end of the file
+    std::set<std::string> using_directives;       // namespaces pulled in with "using namespace"
+    std::set<std::string> identifiers;            // every identifier used, directives included
+};
+
+SourceNames source_names(const std::string& source_file);
+
+// Group units into generated unity sources of up to batch_size files each.
+// Sources listed in exclude, or whose names or macros would clash with
+// another source, keep their own unit. Only sources with the same flags and
+// using-directives share a chunk. Where chunks split depends on the paths
+// of their members alone, and a chunk file is named after its member list,
+// so adding, removing or editing a source recompiles only the chunks around
+// it. Chunk files no longer produced are deleted.
+std::vector<CompileUnit> make_unity_units(const std::vector<CompileUnit>& units,
+    const std::string& build_dir,
+    int batch_size,
+    const std::vector<std::string>& exclude
+);
+
+#endif // UNITY_HPP
@@ -0,0 +1,8 @@
+#ifndef WATCH_HPP
+#define WATCH_HPP
+
+// Rebuild whenever a source, one of its headers or project.json changes.
+// With run, the host binary is restarted after every successful build.
+int watch_project(bool run);
+
+#endif // WATCH_HPP
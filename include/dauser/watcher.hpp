@@ -0,0 +1,36 @@
+#ifndef WATCHER_HPP
+#define WATCHER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+// inotify wrapper shared by the build daemon and the watch command. Every
+// change it reads is also dropped from the in-memory file cache.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Whether change notifications are available on this system
+    bool ok() const;
+
+    // Descriptor that becomes readable when events are pending
+    int fd() const;
+
+    // Watch the entries of a directory; false if it cannot be watched
+    bool add(const std::string& dir);
+
+    // Read all pending events without blocking and return the changed
+    // paths. overflow is set when events were lost and everything must
+    // be treated as changed.
+    std::vector<std::string> drain(bool& overflow);
+
+private:
+    int notify = -1;
+    std::map<int, std::string> watches;
+};
+
+#endif // WATCHER_HPP
@@ -0,0 +1,14 @@
+#ifndef WORKSPACE_HPP
+#define WORKSPACE_HPP
+
+#include <string>
+#include <vector>
+
+// Build members of the workspace.json in the current directory: the
+// requested ones (all when empty) and the members they depend on. Only
+// their project.json files are read, and all their compiles and links run
+// in one job graph under the workspace's "max threads". Returns false if
+// anything failed.
+bool build_workspace(const std::vector<std::string>& members, const std::string& variant);
+
+#endif // WORKSPACE_HPP
@@ -1,219 +1,1006 @@
 #include "../include/dauser/builder.hpp"
 #include "../include/dauser/config.hpp"
 #include "../include/dauser/cmd.hpp"
+#include "../include/dauser/deps.hpp"
+#include "../include/dauser/unity.hpp"
+#include "../include/dauser/pch.hpp"
+#include "../include/dauser/modules.hpp"
+#include "../include/dauser/filecache.hpp"
+#include "../include/dauser/scheduler.hpp"
+#include "../include/dauser/filio.hpp"
+#include "../include/dauser/linker.hpp"
+#include "../include/dauser/pgo.hpp"
+#include "../include/dauser/multiarch.hpp"
+#include "../include/dauser/size.hpp"
 #include <iostream>
 #include <filesystem>
 #include <fstream>
-#include <thread>
 #include <vector>
 #include <mutex>
+#include <thread>
 #include <sstream>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <functional>
 
 namespace fs = std::filesystem;
 
 std::mutex compilation_mutex;
 
-// Compile a single source file to an object file
-void compile_source(const std::string& source_file, const std::string& compiler,
+// Everything that affects the generated object besides the source itself
+std::string compile_signature(const std::string& compiler,
     const std::vector<std::string>& flags,
-    const std::vector<std::string>& includes,
-    const std::string& output_dir
+    const std::vector<std::string>& includes
 ) {
-    std::string base_name = fs::path(source_file).stem().string();
-    std::string obj_file = output_dir + base_name + ".o";
+    std::string signature = compiler;
+    for (const auto& flag : flags) {
+        signature += " " + flag;
+    }
+    for (const auto& inc : includes) {
+        signature += " " + inc;
+    }
+    return signature;
+}
 
-    std::string command = compiler + " -c -fPIC -o \"" + obj_file + "\" \"" + source_file + "\"";
+// Module interface extensions g++ does not recognise as C++ on its own
+std::string language_flag(const std::string& source_file) {
+    std::string ext = fs::path(source_file).extension().string();
+    if (ext == ".cppm" || ext == ".ixx" || ext == ".mpp" || ext == ".mxx") {
+        return " -x c++";
+    }
+    return "";
+}
 
-    for (const auto& flag : flags) {
-        command += " \"" + flag + "\"";
+// Quote an argument for the shell that runs build commands
+static std::string shell_quote(const std::string& arg) {
+    std::string quoted = "\"";
+    for (char ch : arg) {
+#ifdef _WIN32
+        if (ch == '"') quoted += '\\';
+#else
+        if (ch == '"' || ch == '\\' || ch == '$' || ch == '`') quoted += '\\';
+#endif
+        quoted += ch;
+    }
+    return quoted + "\"";
+}
+
+// Quote an argument for a gcc style response file
+static std::string response_quote(const std::string& arg) {
+    std::string quoted = "\"";
+    for (char ch : arg) {
+        if (ch == '"' || ch == '\\') quoted += '\\';
+        quoted += ch;
+    }
+    return quoted + "\"";
+}
+
+std::string command_line(const std::string& program, const std::vector<std::string>& args,
+    const std::string& rsp_dir
+) {
+    std::string command = program;
+    for (const auto& arg : args) {
+        command += " " + shell_quote(arg);
+    }
+    if (rsp_dir.empty() || command.size() <= response_file_threshold) {
+        return command;
+    }
+
+    std::string contents;
+    for (const auto& arg : args) {
+        contents += response_quote(arg) + "\n";
+    }
+    std::string path = fs::absolute(rsp_dir).lexically_normal().string() + "/" + content_hash(contents) + ".rsp";
+    if (!fs::exists(path)) {
+        // Jobs may write the same file at once; each renames a complete copy into place
+        fs::create_directories(fs::path(path).parent_path());
+        std::string temp = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            out << contents;
+        }
+        std::error_code ec;
+        fs::rename(temp, path, ec);
+    }
+    return program + " " + shell_quote("@" + path);
+}
+
+// Arguments that select the language of a source g++ cannot tell by extension
+static void add_source(std::vector<std::string>& args, const std::string& source_file, const std::string& path) {
+    if (!language_flag(source_file).empty()) {
+        args.push_back("-x");
+        args.push_back("c++");
+    }
+    args.push_back(path);
+}
+
+// Compile a single source file to an object file
+int compile_source(const CompileUnit& unit, const std::string& compiler,
+    const std::vector<std::string>& includes
+) {
+    std::string depfile = fs::path(unit.object).replace_extension(".d").string();
+    std::vector<std::string> args = {"-c", "-fPIC", "-MMD", "-MF", depfile, "-o", unit.object};
+    add_source(args, unit.source, unit.source);
+    args.insert(args.end(), unit.flags.begin(), unit.flags.end());
+    args.insert(args.end(), includes.begin(), includes.end());
+    std::string command = command_line(compiler, args, fs::path(unit.object).parent_path().string() + "/rsp");
+
+    {
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cout << "🔨 Compiling: " << unit.source << "\n";
+    }
+
+    int result = run_cmd(command);
+    if (result == 0) {
+        write_signature(unit.object, compile_signature(compiler, unit.flags, includes));
+    }
+    return result;
+}
+
+// Compile several sources with one compiler invocation. All units must share
+// flags and an output directory, and be named <stem>.o, since g++ places the
+// objects of a multi-source "-c" in the working directory.
+int compile_batch(const std::vector<CompileUnit>& units, const std::string& compiler,
+    const std::vector<std::string>& includes
+) {
+    if (units.size() == 1) {
+        return compile_source(units.front(), compiler, includes);
+    }
+
+    std::string output_dir = fs::path(units.front().object).parent_path().string();
+    std::vector<std::string> args = {"-c", "-fPIC", "-MMD"};
+    for (const auto& unit : units) {
+        add_source(args, unit.source, fs::absolute(unit.source).string());
     }
+    args.insert(args.end(), units.front().flags.begin(), units.front().flags.end());
 
+    // The compiler runs from the output directory, so include paths must be absolute
     for (const auto& inc : includes) {
-        command += " \"" + inc + "\"";
+        if (inc.rfind("-I", 0) == 0) {
+            args.push_back("-I" + fs::absolute(inc.substr(2)).string());
+        } else {
+            args.push_back(inc);
+        }
     }
+    std::string command = "cd " + shell_quote(output_dir) + " && " + command_line(compiler, args, output_dir + "/rsp");
 
     {
         std::lock_guard<std::mutex> lock(compilation_mutex);
-        std::cout << "🔨 Compiling: " << source_file << "\n";
+        std::cout << "🔨 Compiling batch of " << units.size() << ":";
+        for (const auto& unit : units) {
+            std::cout << " " << unit.source;
+        }
+        std::cout << "\n";
     }
 
     int result = run_cmd(command);
+    if (result == 0) {
+        std::string signature = compile_signature(compiler, units.front().flags, includes);
+        for (const auto& unit : units) {
+            write_signature(unit.object, signature);
+        }
+    }
+    return result;
 }
-void compile_all(
-    const std::vector<std::string>& src_files,
+
+std::vector<size_t> add_compile_jobs(JobGraph& graph, const std::vector<CompileUnit>& units,
     const std::string& compiler,
-    const std::vector<std::string>& flags,
     const std::vector<std::string>& includes,
-    const std::string& buildpath,
-    int max_threads
+    int max_threads,
+    int batch_size,
+    const std::vector<std::vector<size_t>>& after
 ) {
-    std::vector<std::thread> threads;
-    for (size_t i = 0; i < src_files.size(); ++i) {
-        // Limit active threads
-        while (threads.size() >= max_threads) {
-            threads.front().join();
-            threads.erase(threads.begin());
+    std::vector<size_t> unit_jobs(units.size(), JobGraph::none);
+    if (max_threads < 1) max_threads = 1;
+    if (batch_size < 1) batch_size = 1;
+    auto prerequisites = [&](size_t i) {
+        return i < after.size() ? after[i] : std::vector<size_t>{};
+    };
+
+    // A unit is stale when its object is, or when a unit it waits for is
+    std::vector<int> stale(units.size(), -1);
+    std::function<bool(size_t)> is_stale = [&](size_t i) -> bool {
+        if (stale[i] >= 0) return stale[i] == 1;
+        stale[i] = 1;
+        bool result = false;
+        for (size_t before : prerequisites(i)) {
+            if (before != i && is_stale(before)) result = true;
+        }
+        const CompileUnit& unit = units[i];
+        if (!result) {
+            std::string signature = compile_signature(compiler, unit.flags, includes);
+            result = !object_up_to_date(unit.object, signature, unit.deps);
         }
-        threads.emplace_back(
-            compile_source,
-            src_files[i],
-            compiler,
-            flags,
-            includes,
-            buildpath
-        );
+        stale[i] = result ? 1 : 0;
+        return result;
+    };
+    std::vector<bool> ordered(units.size(), false);
+    for (size_t i = 0; i < units.size(); ++i) {
+        for (size_t before : prerequisites(i)) {
+            if (before < units.size()) ordered[before] = true;
+        }
+        if (!prerequisites(i).empty()) ordered[i] = true;
     }
 
-    // Join remaining threads
-    for (auto& t : threads) {
-        t.join();
+    // Group stale units that could share a compiler invocation
+    std::vector<std::string> group_keys;
+    std::map<std::string, std::vector<size_t>> groups;
+    std::vector<std::vector<size_t>> jobs;
+    size_t up_to_date = 0;
+    for (size_t i = 0; i < units.size(); ++i) {
+        const CompileUnit& unit = units[i];
+        if (!is_stale(i)) {
+            ++up_to_date;
+            continue;
+        }
+        fs::path obj(unit.object);
+        bool batchable = batch_size > 1 && !ordered[i] && obj.filename() == fs::path(unit.source).stem().string() + ".o";
+        if (!batchable) {
+            jobs.push_back({i});
+            continue;
+        }
+        std::string key = compile_signature(compiler, unit.flags, includes) + "\n" + obj.parent_path().string();
+        if (groups.find(key) == groups.end()) {
+            group_keys.push_back(key);
+        }
+        groups[key].push_back(i);
     }
+
+    // Split each group into chunks, never so large that batching costs parallelism
+    for (const auto& key : group_keys) {
+        const std::vector<size_t>& members = groups[key];
+        size_t per_thread = (members.size() + max_threads - 1) / max_threads;
+        size_t chunk = std::max<size_t>(1, std::min<size_t>(batch_size, per_thread));
+        std::vector<size_t> current;
+        std::set<std::string> stems;
+        for (size_t i : members) {
+            std::string stem = fs::path(units[i].source).stem().string();
+            if (current.size() >= chunk || stems.count(stem)) {
+                jobs.push_back(current);
+                current.clear();
+                stems.clear();
+            }
+            current.push_back(i);
+            stems.insert(stem);
+        }
+        if (!current.empty()) {
+            jobs.push_back(current);
+        }
+    }
+
+    if (up_to_date > 0) {
+        std::cout << "⏭️ " << up_to_date << " object(s) up to date\n";
+    }
+
+    // Ids are handed out in order, so jobs can name prerequisites added after them
+    size_t first_id = graph.size();
+    for (size_t n = 0; n < jobs.size(); ++n) {
+        for (size_t i : jobs[n]) {
+            unit_jobs[i] = first_id + n;
+        }
+    }
+    for (const auto& job : jobs) {
+        std::vector<CompileUnit> batch;
+        std::vector<size_t> waits_for;
+        for (size_t i : job) {
+            batch.push_back(units[i]);
+            for (size_t before : prerequisites(i)) {
+                if (before < units.size() && unit_jobs[before] != JobGraph::none && before != i) {
+                    waits_for.push_back(unit_jobs[before]);
+                }
+            }
+        }
+        graph.add([batch, compiler, includes]() {
+            int result = compile_batch(batch, compiler, includes);
+            // Later jobs of the same build must see the new objects
+            for (const auto& unit : batch) {
+                invalidate_file(unit.object);
+                invalidate_file(unit.object + ".cmd");
+                invalidate_file(fs::path(unit.object).replace_extension(".d").string());
+            }
+            return result;
+        }, waits_for);
+    }
+    return unit_jobs;
 }
 
+std::vector<int> compile_all(const std::vector<CompileUnit>& units,
+    const std::string& compiler,
+    const std::vector<std::string>& includes,
+    int max_threads,
+    int batch_size
+) {
+    sync_file_cache();
+    JobGraph graph;
+    std::vector<size_t> unit_jobs = add_compile_jobs(graph, units, compiler, includes, max_threads, batch_size);
+    std::vector<int> job_results = graph.run(max_threads);
+    std::vector<int> results(units.size(), 0);
+    for (size_t i = 0; i < units.size(); ++i) {
+        if (unit_jobs[i] != JobGraph::none) {
+            results[i] = job_results[unit_jobs[i]];
+        }
+    }
+    sync_file_cache();
+    return results;
+}
 
-void build(std::string new_version){
-    json config = load_project_config();
-    int max_threads = config["max threads"];
-    bool c = config["c"];
-    std::string name = config["name"];
-    std::string buildpath = config["buildpath"];
-    std::vector<std::string> src_files = config["srcpath"].is_array() ?
-    config["srcpath"].get<std::vector<std::string>>() :
-    std::vector<std::string>{config["srcpath"].get<std::string>()};
+std::string platform_compiler(const std::string& platform, bool c) {
+    if (platform == "linux") {
+        return c ? "gcc" : "g++";
+    }
+    if (platform == "windows") {
+        return c ? "x86_64-w64-mingw32-gcc" : "x86_64-w64-mingw32-g++";
+    }
+    if (platform == "macos") {
+        return c ? "clang" : "clang++";
+    }
+    return "";
+}
+
+std::string platform_archiver(const std::string& platform) {
+    if (platform == "windows") {
+        return "x86_64-w64-mingw32-ar";
+    }
+    return "ar";
+}
+
+std::vector<std::string> target_flags(const json& settings, const std::string& variant,
+    const std::string& platform, const std::string& compiler, const std::string& buildpath
+) {
+    std::vector<std::string> flags = variant_flags(settings, variant);
+    // LTO flags go to compiles and links alike, so they are part of
+    // every object's signature and switching modes rebuilds
+    std::vector<std::string> lto_flags = lto_compile_flags(lto_mode(settings, variant), compiler);
+    flags.insert(flags.end(), lto_flags.begin(), lto_flags.end());
+    std::vector<std::string> pgo_flags = profile_flags(settings, variant, compiler, buildpath);
+    flags.insert(flags.end(), pgo_flags.begin(), pgo_flags.end());
+    // Split DWARF keeps most debug info out of the objects the linker reads
+    if (variant_value(settings, variant, "split dwarf", false).get<bool>() && platform == "linux") {
+        flags.push_back("-gsplit-dwarf");
+    }
+    // Functions can only be reordered when each has its own section
+    if (!function_order_profile(settings, variant).empty()) {
+        flags.push_back("-ffunction-sections");
+    }
+    return flags;
+}
+
+std::string output_path(const json& config, const std::string& platform, const std::string& version,
+    const std::string& variant
+) {
+    std::string buildpath = variant_buildpath(config, variant);
     std::string type = config["type"];
-    std::vector<std::string> includepaths = config.value("includepaths", std::vector<std::string>{"./include/*"});
-    std::string config_version = config["version"];
-    std::vector<std::string> flags;
-    if(new_version == ""){
-        new_version = config_version;
+    if (config.value("override binary name", false)) {
+        return buildpath + config["binary name"].get<std::string>() + '_' + platform;
+    }
+    std::string extension;
+    if (platform == "linux") {
+        extension = (type == "shared") ? ".so" : (type == "static") ? ".a" : "";
+    } else if (platform == "windows") {
+        extension = (type == "shared") ? ".dll" : (type == "static") ? ".lib" : ".exe";
+    } else if (platform == "macos") {
+        extension = (type == "shared") ? ".dylib" : (type == "static") ? ".a" : "";
     }
+    return buildpath + config["name"].get<std::string>() + "-" + version + "-" + platform + extension;
+}
 
-    if (config["flags"].is_string()) {
-        std::istringstream iss(config["flags"].get<std::string>());
-        std::string flag;
-        while (iss >> flag) flags.push_back(flag);
-    } else if (config["flags"].is_array()) {
-        flags = config["flags"].get<std::vector<std::string>>();
+// Command listing the symbols a shared library exports, or "" if the
+// platform has no supported tool
+static std::string interface_command(const std::string& platform, const std::string& library) {
+    if (platform == "linux") {
+        return "nm -D --defined-only -P \"" + library + "\"";
+    }
+    if (platform == "macos") {
+        return "nm -gUP \"" + library + "\"";
     }
-    bool override_name = config["override binary name"];
-    std::string override = config["binary name"];
+    return "";
+}
 
-    fs::create_directories(fs::path(buildpath));
-    std::vector<std::string> platforms = config.value("platforms", std::vector<std::string>{"linux"});
-    bool all_success = true;
+// Record the exported interface of a shared library in interface_file,
+// touching it only when the interface changed. Addresses are left out, and
+// sizes are kept only for data, whose size is part of the ABI.
+static void update_interface(const std::string& command, const std::string& library,
+    const std::string& interface_file
+) {
+    std::string listing;
+    std::string text = fs::path(library).filename().string() + "\n";
+    if (!command.empty() && capture_cmd(command + " 2>/dev/null", listing) == 0 && !listing.empty()) {
+        std::istringstream lines(listing);
+        std::string line;
+        std::vector<std::string> symbols;
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            std::string name, type, value, size;
+            if (!(fields >> name >> type)) continue;
+            fields >> value >> size;
+            bool data = std::string("BbDdGgRrSsVv").find(type) != std::string::npos;
+            symbols.push_back(name + " " + type + (data ? " " + size : ""));
+        }
+        std::sort(symbols.begin(), symbols.end());
+        for (const auto& symbol : symbols) {
+            text += symbol + "\n";
+        }
+    } else {
+        // Without a symbol listing, any change to the library counts
+        std::vector<char> bytes = filio::bin_read(library);
+        text += std::string(bytes.begin(), bytes.end());
+    }
 
-    for (const std::string& platform : platforms) {
-        std::string compiler, extension;
+    std::string hash = content_hash(text);
+    std::string recorded;
+    if (!read_file_cached(interface_file, recorded) || recorded != hash) {
+        std::ofstream out(interface_file, std::ios::trunc);
+        out << hash;
+    }
+    invalidate_file(interface_file);
+}
 
-        if (platform == "linux") {
-            compiler = c ? "gcc" : "g++";
-            extension = (type == "shared") ? ".so" : "";
+// Link one target once its objects and dependencies are ready, unless the
+// output is already up to date. A shared library also gets its interface
+// file updated, which dependents check instead of the library itself.
+static int link_target(const std::string& link_command, const std::string& outname,
+    const std::string& link_stamp, const std::vector<std::string>& link_inputs, const std::string& label,
+    const std::string& interface_command, const std::string& interface_file
+) {
+    // Relink only when an object or the link command changed
+    if (output_up_to_date(outname, link_stamp, link_command, link_inputs)) {
+        fs::file_time_type time;
+        if (!interface_file.empty() && !file_mtime(interface_file, time)) {
+            update_interface(interface_command, outname, interface_file);
         }
-        else if (platform == "windows") {
-            compiler = c ? "x86_64-w64-mingw32-gcc" : "x86_64-w64-mingw32-g++";
-            extension = (type == "shared") ? ".dll" : ".exe";
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cout << "✅ Up to date for " << label << " -> " << outname << "\n";
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cout << "🔗 Linking: " << outname << "\n";
+    }
+    int link_result = run_cmd(link_command);
+    if (link_result == 0) {
+        write_signature(link_stamp, link_command);
+        invalidate_file(outname);
+        invalidate_file(link_stamp + ".cmd");
+        if (!interface_file.empty()) {
+            update_interface(interface_command, outname, interface_file);
         }
-        else if (platform == "macos") {
-            compiler = c ? "clang" : "clang++";
-            extension = (type == "shared") ? ".dylib" : "";
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cout << "✅ Built for " << label << " -> " << outname << "\n";
+    }
+    return link_result;
+}
+
+// Build a static archive or a partially linked object from objects. The
+// output is built in staging and only replaces outname when its contents
+// differ, so whatever links it sees a new timestamp only when something in
+// it changed. The stamp's own timestamp records when the objects were last
+// combined. Without a label only the work itself is reported.
+static int staged_target(const std::string& command, const std::string& outname,
+    const std::string& staging, const std::string& link_stamp, const std::vector<std::string>& link_inputs,
+    bool thin, const std::string& label, const std::string& action
+) {
+    if (fs::exists(outname) && output_up_to_date(link_stamp + ".cmd", link_stamp, command, link_inputs)) {
+        if (!label.empty()) {
+            std::lock_guard<std::mutex> lock(compilation_mutex);
+            std::cout << "✅ Up to date for " << label << " -> " << outname << "\n";
         }
-        else {
-            std::cerr << "⚠️ Unsupported platform: " << platform << "\n";
-            continue;
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cout << action << ": " << outname << "\n";
+    }
+    std::error_code ec;
+    fs::remove(staging, ec);
+    int result = run_cmd(command);
+    if (result != 0) {
+        fs::remove(staging, ec);
+        return result;
+    }
+
+    // A thin archive only names its members, so it must be replaced whenever they change
+    bool unchanged = !thin && fs::exists(outname) && filio::bin_read(outname) == filio::bin_read(staging);
+    if (unchanged) {
+        fs::remove(staging, ec);
+    } else {
+        fs::rename(staging, outname, ec);
+        if (ec) {
+            std::cerr << "❌ Could not replace " << outname << ": " << ec.message() << "\n";
+            return 1;
         }
+    }
+    write_signature(link_stamp, command);
+    invalidate_file(outname);
+    invalidate_file(link_stamp + ".cmd");
+    if (!label.empty()) {
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cout << (unchanged ? "✅ Unchanged for " : "✅ Built for ") << label << " -> " << outname << "\n";
+    }
+    return 0;
+}
 
-        try {
-            config["version"] = new_version;
-            std::ofstream out("project.json");
-            out << config.dump(4);
-            std::cout << "🔄 Updated version to: " << new_version << "\n";
-        } catch(std::exception) {
-            std::cout << "⚠️ version not updated due to an unexpected error";
+// Run-time search path entry that finds library from the directory of output
+static std::string rpath_entry(const std::string& platform, const std::string& output, const std::string& library) {
+    std::string relative = fs::path(library).parent_path().lexically_relative(fs::path(output).parent_path()).string();
+    std::string origin = platform == "macos" ? "@loader_path" : "$ORIGIN";
+    return (relative.empty() || relative == ".") ? origin : origin + "/" + relative;
+}
+
+std::vector<PlannedLink> plan_project(BuildPlan& plan, const json& config, const BuildOptions& options,
+    const std::string& version, const std::string& project, const std::vector<PlannedLink>& external
+) {
+    std::vector<PlannedLink> links;
+    const std::string& only_platform = options.platform;
+    std::string variant = selected_variant(config, options.variant);
+    std::vector<std::string> targets = target_build_order(config, options.target);
+    int max_threads = config["max threads"];
+    int batch_size = config.value("batch size", 1);
+    bool c = config["c"];
+    std::string buildpath = variant_buildpath(config, variant);
+    std::string prefix = project.empty() ? "" : project + ": ";
+
+    fs::create_directories(fs::path(buildpath));
+    std::vector<std::string> platforms = config.value("platforms", std::vector<std::string>{"linux"});
+    if (!only_platform.empty()) {
+        if (std::find(platforms.begin(), platforms.end(), only_platform) == platforms.end()) {
+            std::cout << "❌ " << prefix << "Platform " << only_platform << " is not listed in platforms\n";
+            plan.ok = false;
+            return links;
+        }
+        platforms = {only_platform};
+    }
+
+    for (const std::string& platform : platforms) {
+        std::string compiler = platform_compiler(platform, c);
+        if (compiler.empty()) {
+            std::cerr << "⚠️ Unsupported platform: " << platform << "\n";
+            continue;
         }
 
         std::string platform_build_dir = buildpath + platform + "/";
         fs::create_directories(fs::path(platform_build_dir));
+        std::cout << "📦 " << prefix << "Starting compilation for platform: " << platform
+                  << (variant.empty() ? "" : " (" + variant + ")") << "\n";
 
-        std::vector<std::string> includes = expand_includes(includepaths);
-        std::vector<int> compilation_results(src_files.size(), 0);
+        // Links of the targets planned so far
+        std::map<std::string, PlannedLink> planned;
+        // Object and job of each source compiled with a given signature, so
+        // targets sharing sources and settings compile them once
+        std::map<std::string, std::pair<std::string, size_t>> shared_objects;
+        // Dispatcher job of each multiarch object, shared the same way
+        std::map<std::string, size_t> multiarch_jobs;
 
-        // Compile each source file
-        std::cout << "📦 Starting compilation for platform: " << platform << "\n";
-        compile_all(src_files,compiler,flags,includes,platform_build_dir,max_threads);
-        // Check if all compilations succeeded
-        bool compilation_success = true;
-        for (int result : compilation_results) {
-            if (result != 0) {
-                compilation_success = false;
-                break;
+        for (const std::string& target : targets) {
+            json settings = target_config(config, target);
+            std::string label = prefix + (target.empty() ? platform : platform + " [" + target + "]");
+            bool unity = settings.value("unity", false);
+            int unity_batch_size = settings.value("unity batch size", 8);
+            std::vector<std::string> unity_exclude = settings.value("unity exclude", std::vector<std::string>{});
+            std::string pch = settings.value("pch", "");
+            double pch_threshold = settings.value("pch threshold", 0.5);
+            bool modules = settings.value("modules", false);
+            if (modules && unity) {
+                std::cout << "⚠️ Unity builds cannot be combined with modules, disabling unity\n";
+                unity = false;
             }
-        }
+            std::vector<std::string> src_files = project_sources(settings);
+            std::string type = settings["type"];
+            std::vector<std::string> includepaths = settings.value("includepaths", std::vector<std::string>{"./include/*"});
+            std::vector<std::string> flags = target_flags(settings, variant, platform, compiler, buildpath);
+            std::string lto = lto_mode(settings, variant);
+            bool split_dwarf = variant_value(settings, variant, "split dwarf", false).get<bool>() && platform == "linux";
+            bool separate_debug = variant_value(settings, variant, "separate debug", false).get<bool>() && platform == "linux";
+            std::string order_profile = function_order_profile(settings, variant);
+            std::vector<std::string> depends = settings.value("depends", std::vector<std::string>{});
 
-        if (!compilation_success) {
-            std::cout << "❌ Build failed for platform: " << platform << " (compilation stage)\n";
-            all_success = false;
-            continue;
-        }
+            std::string target_build_dir = target.empty() ? platform_build_dir : platform_build_dir + target + "/";
+            fs::create_directories(fs::path(target_build_dir));
 
-        // Link all object files together
-        std::string outname = buildpath + name + "-" + new_version + "-" + platform + extension;
-        if (override_name) {
-            outname = buildpath + override + '_' + platform;
-        }
+            std::vector<std::string> includes = expand_includes(includepaths);
+            std::vector<CompileUnit> units;
+            for (const auto& src_file : src_files) {
+                std::string base_name = fs::path(src_file).stem().string();
+                units.push_back({src_file, target_build_dir + base_name + ".o", flags});
+            }
+            // Multiarch sources are compiled once per level, so they stay out of unity files
+            std::vector<std::string> levels = multiarch_levels(settings);
+            if (!levels.empty() && (platform != "linux" || modules)) {
+                std::cout << "⚠️ Multiarch builds need GNU ifunc and no modules, building "
+                          << label << " for the baseline only\n";
+                levels.clear();
+            }
+            if (!levels.empty()) {
+                std::vector<std::string> multiarch = settings.value("multiarch", std::vector<std::string>{});
+                unity_exclude.insert(unity_exclude.end(), multiarch.begin(), multiarch.end());
+            }
+            if (unity) {
+                units = make_unity_units(units, target_build_dir, unity_batch_size, unity_exclude);
+            }
+            // Objects optimized with a profile recompile when their part of it changes
+            for (auto& unit : units) {
+                std::string profile = profile_dependency(settings, variant, compiler, buildpath, unit.object);
+                if (!profile.empty()) unit.deps.push_back(profile);
+            }
+            // Each multiarch unit gets a copy per level. Their objects are
+            // rewritten after compiling, which LTO objects do not allow.
+            std::vector<std::pair<size_t, std::vector<size_t>>> multiarch_units;
+            std::vector<bool> multiarch(units.size(), false);
+            size_t first_copy = units.size();
+            for (size_t i = 0; i < first_copy && !levels.empty(); ++i) {
+                if (!is_multiarch_source(settings, units[i].source)) continue;
+                if (!lto.empty()) units[i].flags.push_back("-fno-lto");
+                std::vector<size_t> copies;
+                for (const auto& level : levels) {
+                    CompileUnit copy = units[i];
+                    copy.object = level_object(units[i].object, level);
+                    copy.flags.push_back("-march=" + level);
+                    copies.push_back(units.size());
+                    units.push_back(copy);
+                }
+                multiarch_units.push_back({i, copies});
+            }
+            multiarch.resize(units.size(), false);
+            for (const auto& entry : multiarch_units) {
+                multiarch[entry.first] = true;
+                for (size_t copy : entry.second) multiarch[copy] = true;
+            }
+            if (!pch.empty()) {
+                std::string pch_header = prepare_pch(pch, units, compiler, flags, includes, target_build_dir, c, pch_threshold);
+                if (!pch_header.empty()) {
+                    // The header is precompiled for the baseline, which level copies cannot use
+                    for (size_t i = 0; i < first_copy; ++i) {
+                        use_pch(units[i], pch_header);
+                    }
+                }
+            }
+            std::vector<std::vector<size_t>> after;
+            if (modules && !prepare_modules(units, compiler, target_build_dir, after)) {
+                std::cout << "❌ Build failed for platform: " << label << " (compilation stage)\n";
+                plan.ok = false;
+                continue;
+            }
 
-        std::string link_command = compiler + " -o \"" + outname + "\"";
+            // Module units keep their positions, since after refers to them
+            std::vector<size_t> unit_jobs(units.size(), JobGraph::none);
+            std::vector<CompileUnit> own_units;
+            std::vector<size_t> own_positions;
+            std::vector<std::string> own_keys;
+            for (size_t i = 0; i < units.size(); ++i) {
+                std::string key = fs::absolute(units[i].source).lexically_normal().string() + "\n" +
+                    compile_signature(compiler, units[i].flags, includes);
+                auto it = shared_objects.find(key);
+                if (!modules && it != shared_objects.end()) {
+                    units[i].object = it->second.first;
+                    unit_jobs[i] = it->second.second;
+                    continue;
+                }
+                own_units.push_back(units[i]);
+                own_positions.push_back(i);
+                own_keys.push_back(key);
+            }
+            std::vector<size_t> own_jobs = add_compile_jobs(plan.graph, own_units, compiler, includes, max_threads, batch_size, after);
+            for (size_t n = 0; n < own_units.size(); ++n) {
+                unit_jobs[own_positions[n]] = own_jobs[n];
+                if (!modules) {
+                    shared_objects[own_keys[n]] = {own_units[n].object, own_jobs[n]};
+                }
+            }
 
-        // Add all compiled object files
-        for (const auto& src_file : src_files) {
-            std::string base_name = fs::path(src_file).stem().string();
-            std::string obj_file = platform_build_dir + base_name + ".o";
-            link_command += " \"" + obj_file + "\"";
-        }
+            // Link all object files together
+            std::string outname = output_path(settings, platform, version, variant);
 
-        // Apply platform-specific shared library flags
-        if (type == "shared") {
-            if (platform == "macos") {
-                link_command += " -dynamiclib";
+            std::string link_stamp = platform_build_dir + fs::path(outname).filename().string();
+            std::string staging = link_stamp + ".tmp";
+            std::string rsp_dir = platform_build_dir + "rsp";
+            bool thin = settings.value("thin archive", false);
+            std::vector<std::string> link_args;
+            if (type == "static") {
+                link_args = {std::string(thin ? "rcsT" : "rcs") + (platform == "macos" ? "" : "D"), staging};
             } else {
-                link_command += " -shared";
+                link_args = {"-o", outname};
             }
-        }
+            std::vector<std::string> link_inputs;
 
-        for (const auto& flag : flags) {
-            link_command += " \"" + flag + "\"";
-        }
+            BuildOutcome outcome{label, {}, {}, JobGraph::none};
+            for (size_t job : unit_jobs) {
+                if (job != JobGraph::none) outcome.compile_jobs.push_back(job);
+            }
+            std::vector<size_t> input_jobs;
 
-        std::cout << "🔗 Linking: " << outname << "\n";
-        int link_result = run_cmd(link_command);
+            // With prelink, the objects of each source directory are combined
+            // into one relocatable object (ld -r) that is only rebuilt when a
+            // member changes, so the final link reads a handful of inputs
+            std::vector<bool> prelinked(units.size(), false);
+            std::map<std::string, std::vector<std::string>> prelink_members;
+            bool prelink = settings.value("prelink", false) && type != "static";
+            if (prelink && !lto.empty()) {
+                std::cout << "⚠️ Prelinking cannot be combined with LTO, disabling prelink for " << label << "\n";
+                prelink = false;
+            }
+            if (prelink) {
+                size_t min_objects = settings.value("prelink min objects", 4);
+                std::map<std::string, std::vector<size_t>> directories;
+                for (size_t i = 0; i < units.size(); ++i) {
+                    if (multiarch[i]) continue;
+                    directories[fs::path(units[i].source).parent_path().lexically_normal().string()].push_back(i);
+                }
+                for (const auto& directory : directories) {
+                    if (directory.second.size() < min_objects) continue;
+                    std::string name = fs::path(directory.first).filename().string();
+                    std::string object = target_build_dir + "prelink/" + (name.empty() ? "root" : name) + "-" +
+                        content_hash(directory.first).substr(0, 8) + ".o";
+                    fs::create_directories(target_build_dir + "prelink");
+                    std::vector<std::string> args = {"-r", "-nostdlib", "-o", object + ".tmp"};
+                    std::vector<std::string> members;
+                    std::vector<size_t> member_jobs;
+                    for (size_t i : directory.second) {
+                        args.push_back(units[i].object);
+                        members.push_back(units[i].object);
+                        if (unit_jobs[i] != JobGraph::none) member_jobs.push_back(unit_jobs[i]);
+                        prelinked[i] = true;
+                    }
+                    std::string command = command_line(compiler, args, rsp_dir);
+                    input_jobs.push_back(plan.graph.add([command, object, members]() {
+                        return staged_target(command, object, object + ".tmp", object, members, false, "", "🧩 Prelinking");
+                    }, member_jobs));
+                    link_args.push_back(object);
+                    link_inputs.push_back(object);
+                    prelink_members[object] = members;
+                }
+            }
 
-        if (link_result != 0) {
-            std::cout << "❌ Build failed for platform: " << platform << " (linking stage)\n";
-            all_success = false;
-        } else {
-            std::cout << "✅ Built for " << platform << " -> " << outname << "\n";
-        }
+            // Add all compiled object files. A thin archive records member
+            // paths relative to where it is staged, so it gets absolute ones.
+            auto add_object = [&](const std::string& object) {
+                link_args.push_back(thin && type == "static" ? fs::absolute(object).lexically_normal().string() : object);
+                link_inputs.push_back(object);
+            };
+            std::vector<std::string> late_objects;
+            for (const auto& entry : multiarch_units) {
+                const std::string& object = units[entry.first].object;
+                auto it = multiarch_jobs.find(object);
+                if (it == multiarch_jobs.end()) {
+                    std::vector<size_t> compiled;
+                    if (unit_jobs[entry.first] != JobGraph::none) compiled.push_back(unit_jobs[entry.first]);
+                    for (size_t copy : entry.second) {
+                        if (unit_jobs[copy] != JobGraph::none) compiled.push_back(unit_jobs[copy]);
+                    }
+                    size_t job = plan.graph.add([object, levels, compiler]() {
+                        return build_multiarch(object, levels, compiler);
+                    }, compiled);
+                    it = multiarch_jobs.insert({object, job}).first;
+                }
+                input_jobs.push_back(it->second);
+                MultiarchObjects objects = multiarch_objects(object, levels);
+                for (const auto& first : objects.first) add_object(first);
+                late_objects.insert(late_objects.end(), objects.last.begin(), objects.last.end());
+            }
+            for (size_t i = 0; i < units.size(); ++i) {
+                if (prelinked[i] || multiarch[i]) continue;
+                add_object(units[i].object);
+                if (unit_jobs[i] != JobGraph::none) input_jobs.push_back(unit_jobs[i]);
+            }
+            for (const auto& object : late_objects) add_object(object);
+            // Size reports name the objects a prelink group was made of
+            std::vector<std::string> objects;
+            for (const auto& input : link_inputs) {
+                auto it = prelink_members.find(input);
+                if (it == prelink_members.end()) {
+                    objects.push_back(input);
+                } else {
+                    objects.insert(objects.end(), it->second.begin(), it->second.end());
+                }
+            }
 
-        // Clean up object files (main thread)
-        std::cout << "🧹 Cleaning up temporary object files...\n";
-        for (const auto& src_file : src_files) {
-            std::string base_name = fs::path(src_file).stem().string();
-            std::string obj_file = platform_build_dir + base_name + ".o";
-            try {
-                if (fs::exists(obj_file)) {
-                    fs::remove(obj_file);
+            // Libraries of the targets and projects this one depends on are
+            // linked in, and shared ones are found relative to it at run time
+            std::vector<PlannedLink> dependencies;
+            for (const auto& link : external) {
+                if (link.platform == platform) dependencies.push_back(link);
+            }
+            bool dependency_missing = false;
+            for (const auto& dep : depends) {
+                auto it = planned.find(dep);
+                if (it == planned.end()) {
+                    dependency_missing = true;
+                    continue;
                 }
-            } catch (const std::exception& e) {
-                std::cerr << "⚠️ Failed to delete " << obj_file << ": " << e.what() << "\n";
+                dependencies.push_back(it->second);
+            }
+            if (dependency_missing) {
+                std::cout << "❌ Build failed for platform: " << label << " (a dependency failed)\n";
+                plan.ok = false;
+                continue;
+            }
+            std::vector<LinkedLibrary> libraries;
+            std::set<std::string> rpaths;
+            for (const auto& dependency : dependencies) {
+                outcome.dependency_jobs.push_back(dependency.job);
+                for (const auto& library : dependency.libraries) {
+                    bool seen = std::any_of(libraries.begin(), libraries.end(),
+                        [&](const LinkedLibrary& other) { return other.path == library.path; });
+                    if (seen) continue;
+                    libraries.push_back(library);
+                    if (!library.archive) {
+                        rpaths.insert(rpath_entry(platform, outname, library.path));
+                    }
+                }
+            }
+            std::vector<size_t> waits_for = input_jobs;
+            waits_for.insert(waits_for.end(), outcome.dependency_jobs.begin(), outcome.dependency_jobs.end());
+
+            // A static target is linked by its dependents together with the
+            // libraries it needs itself
+            if (type == "static") {
+                libraries.insert(libraries.begin(), {outname, outname, true});
+                // The macOS ar does not read response files
+                // LTO objects need an archiver that can index their symbols
+                std::string archiver = lto.empty() ? platform_archiver(platform) : lto_archiver(platform, compiler);
+                std::string link_command = command_line(archiver, link_args,
+                    platform == "macos" ? "" : rsp_dir);
+                outcome.link_job = plan.graph.add([link_command, outname, staging, link_stamp, link_inputs, thin, label]() {
+                    return staged_target(link_command, outname, staging, link_stamp, link_inputs, thin, label, "📚 Archiving");
+                }, waits_for);
+                planned[target] = {platform, outname, type, outcome.link_job, libraries};
+                links.push_back(planned[target]);
+                plan.outcomes.push_back(outcome);
+                continue;
+            }
+            for (const auto& library : libraries) {
+                link_args.push_back(library.path);
+                link_inputs.push_back(library.stamp);
+            }
+
+            // Apply platform-specific shared library flags
+            std::string file_name = fs::path(outname).filename().string();
+            if (type == "shared") {
+                if (platform == "macos") {
+                    link_args.push_back("-dynamiclib");
+                    link_args.push_back("-Wl,-install_name,@rpath/" + file_name);
+                } else {
+                    link_args.push_back("-shared");
+                    if (platform == "linux") link_args.push_back("-Wl,-soname," + file_name);
+                }
+            }
+            if (platform == "linux" || platform == "macos") {
+                for (const auto& rpath : rpaths) {
+                    link_args.push_back("-Wl,-rpath," + rpath);
+                }
+            }
+
+            link_args.insert(link_args.end(), flags.begin(), flags.end());
+            std::string linker = select_linker(settings, platform, compiler);
+            int link_threads = std::min(settings.value("link threads", default_link_threads(linker, max_threads)), max_threads);
+            std::vector<std::string> extra = linker_flags(linker, link_threads);
+            link_args.insert(link_args.end(), extra.begin(), extra.end());
+            if (split_dwarf && (linker == "gold" || linker == "lld" || linker == "mold")) {
+                link_args.push_back("-Wl,--gdb-index");
+            }
+
+            // The linker and the LTO backend run their own threads; the link
+            // job reserves them in the scheduler so compiles do not
+            // oversubscribe the host
+            int lto_jobs = std::min(settings.value("lto jobs", max_threads), max_threads);
+            std::vector<std::string> lto_link = lto_link_flags(lto, compiler, linker, platform, lto_jobs,
+                fs::absolute(platform_build_dir + "lto-cache").string());
+            link_args.insert(link_args.end(), lto_link.begin(), lto_link.end());
+            int link_weight = std::max(linker_weight(linker, link_threads), lto_link_weight(lto, compiler, lto_jobs));
+
+            // Hot functions first keeps them on few pages; the order file is
+            // an input, so a new profile relinks
+            if (!order_profile.empty()) {
+                std::string order_file = target_build_dir + "function-order.txt";
+                std::vector<std::string> order = function_order_flags(order_profile, linker, platform, order_file);
+                link_args.insert(link_args.end(), order.begin(), order.end());
+                if (!order.empty()) link_inputs.push_back(order_file);
+            }
+
+            // Long commands go through a response file named after its
+            // contents, so the command, and with it the link signature,
+            // changes exactly when the arguments do
+            std::string link_command = command_line(compiler, link_args, rsp_dir);
+
+            // Dependents of a shared library relink only when its exported
+            // symbols change, since the loader resolves them at run time
+            std::string symbols_command = type == "shared" ? interface_command(platform, outname) : "";
+            std::string interface_file = symbols_command.empty() ? "" : link_stamp + ".iface";
+            outcome.link_job = plan.graph.add([=]() {
+                return link_target(link_command, outname, link_stamp, link_inputs, label,
+                    symbols_command, interface_file);
+            }, waits_for, link_weight);
+            // Debug info is split off in a job of its own, so other work goes
+            // on meanwhile; dependents wait for it since it rewrites outname
+            if (split_dwarf || separate_debug) {
+                std::string debug_stamp = link_stamp + ".debug-stamp";
+                outcome.link_job = plan.graph.add([=]() {
+                    return separate_debug_info(outname, debug_stamp, split_dwarf, separate_debug);
+                }, {outcome.link_job});
             }
+            // Size reports only read the output, so nothing waits for them
+            std::string size_dir = size_report_dir(settings);
+            if (!size_dir.empty() && platform != "macos") {
+                json info = {{"target", target}, {"platform", platform}, {"version", version}, {"variant", variant}};
+                plan.graph.add([=]() {
+                    record_size_report(outname, objects, platform, size_dir, info);
+                    return 0;
+                }, {outcome.link_job});
+            }
+            std::vector<LinkedLibrary> exported;
+            if (type == "shared") {
+                exported.push_back({outname, symbols_command.empty() ? outname : interface_file, false});
+            }
+            planned[target] = {platform, outname, type, outcome.link_job, exported};
+            links.push_back(planned[target]);
+            plan.outcomes.push_back(outcome);
+        }
+    }
+    return links;
+}
+
+bool run_plan(BuildPlan& plan, int max_threads) {
+    bool all_success = plan.ok;
+    std::vector<int> results = plan.graph.run(max_threads);
+    sync_file_cache();
+
+    for (const auto& outcome : plan.outcomes) {
+        auto failed = [&](const std::vector<size_t>& jobs) {
+            return std::any_of(jobs.begin(), jobs.end(), [&](size_t job) { return results[job] != 0; });
+        };
+        if (results[outcome.link_job] == 0) {
+            continue;
         }
+        all_success = false;
+        if (failed(outcome.compile_jobs)) {
+            std::cout << "❌ Build failed for platform: " << outcome.label << " (compilation stage)\n";
+        } else if (failed(outcome.dependency_jobs)) {
+            std::cout << "❌ Build failed for platform: " << outcome.label << " (a dependency failed)\n";
+        } else {
+            std::cout << "❌ Build failed for platform: " << outcome.label << " (linking stage)\n";
+        }
+    }
+    return all_success;
+}
+
+bool build_config(const json& config, const BuildOptions& options, std::vector<std::string>& outputs) {
+    BuildPlan plan;
+    sync_file_cache();
+    std::vector<PlannedLink> links = plan_project(plan, config, options, config["version"]);
+    if (plan.outcomes.empty() && !plan.ok) {
+        return false;
+    }
+    for (const auto& link : links) {
+        outputs.push_back(link.output);
+    }
+    return run_plan(plan, config["max threads"]);
+}
+
+bool build(BuildOptions options){
+    json config = load_project_config();
+    std::string new_version = options.version;
+    std::string config_version = config["version"];
+    if(new_version == ""){
+        new_version = config_version;
+    }
 
-        // Clean up empty platform directory if it exists and is empty
+    BuildPlan plan;
+    sync_file_cache();
+    plan_project(plan, config, options, new_version);
+    if (plan.outcomes.empty() && !plan.ok) {
+        return false;
+    }
+
+    if (config["version"] != new_version) {
         try {
-            if (fs::exists(platform_build_dir) && fs::is_empty(platform_build_dir)) {
-                fs::remove(platform_build_dir);
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "⚠️ Failed to clean up directory: " << e.what() << "\n";
+            config["version"] = new_version;
+            std::ofstream out("project.json");
+            out << config.dump(4);
+            std::cout << "🔄 Updated version to: " << new_version << "\n";
+        } catch(const std::exception&) {
+            std::cout << "⚠️ version not updated due to an unexpected error";
         }
     }
+    return run_plan(plan, config["max threads"]);
 }
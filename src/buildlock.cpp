@@ -0,0 +1,119 @@
+#include "../include/dauser/buildlock.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/config.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+#ifdef _WIN32
+
+bool coalesced_build(const BuildOptions& options) {
+    return build(options);
+}
+
+BuildLocks::BuildLocks(const std::vector<std::string>&) {}
+BuildLocks::~BuildLocks() {}
+
+#else
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Outcome of the last build that held the lock
+struct BuildResult {
+    unsigned long generation = 0;
+    bool success = false;
+    std::string request;
+};
+
+static BuildResult read_result(const std::string& path) {
+    BuildResult result;
+    std::ifstream in(path);
+    int success = 0;
+    if (in >> result.generation >> success) {
+        result.success = success != 0;
+        in.ignore(1);
+        std::getline(in, result.request);
+    }
+    return result;
+}
+
+static void write_result(const std::string& path, const BuildResult& result) {
+    std::ofstream out(path, std::ios::trunc);
+    out << result.generation << " " << (result.success ? 1 : 0) << "\n" << result.request << "\n";
+}
+
+bool coalesced_build(const BuildOptions& options) {
+    json config = load_project_config();
+    std::string variant = selected_variant(config, options.variant);
+    std::string request = options.version + "\t" + options.platform + "\t" + variant + "\t" + options.target;
+    std::string buildpath = variant_buildpath(config, variant);
+    fs::create_directories(buildpath);
+    std::string lock_file = buildpath + ".build.lock";
+    std::string result_file = buildpath + ".build.result";
+
+    int fd = open(lock_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return build(options);
+    }
+
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        BuildResult before = read_result(result_file);
+        std::cout << "⏳ Another jmakepp build of this project is running, waiting for it...\n";
+        std::cout.flush();
+        flock(fd, LOCK_EX);
+        BuildResult after = read_result(result_file);
+        if (after.generation != before.generation && after.request == request) {
+            close(fd);
+            std::cout << "⏭️ Joined the running build: " << (after.success ? "✅ succeeded" : "❌ failed") << "\n";
+            return after.success;
+        }
+    }
+
+    // Holding the lock: build, then publish the result to anyone waiting
+    BuildResult result = read_result(result_file);
+    result.generation++;
+    result.request = request;
+    auto publish = [&](bool success) {
+        result.success = success;
+        write_result(result_file, result);
+        close(fd);
+    };
+    try {
+        publish(build(options));
+    } catch (...) {
+        publish(false);
+        throw;
+    }
+    return result.success;
+}
+
+BuildLocks::BuildLocks(const std::vector<std::string>& buildpaths) {
+    std::set<std::string> lock_files;
+    for (const auto& buildpath : buildpaths) {
+        fs::create_directories(buildpath);
+        lock_files.insert(fs::weakly_canonical(fs::path(buildpath) / ".build.lock").string());
+    }
+    for (const auto& lock_file : lock_files) {
+        int fd = open(lock_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) continue;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            std::cout << "⏳ Waiting for another jmakepp build in " << fs::path(lock_file).parent_path().string() << "...\n";
+            std::cout.flush();
+            flock(fd, LOCK_EX);
+        }
+        fds.push_back(fd);
+    }
+}
+
+BuildLocks::~BuildLocks() {
+    for (int fd : fds) {
+        close(fd);
+    }
+}
+
+#endif
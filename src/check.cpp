@@ -0,0 +1,88 @@
+#include "../include/dauser/check.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/config.hpp"
+#include "../include/dauser/linker.hpp"
+#include "../include/dauser/modules.hpp"
+#include "../include/dauser/multiarch.hpp"
+#include "../include/dauser/pch.hpp"
+#include "../include/dauser/platform.hpp"
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+int check_file(const std::string& file, bool object) {
+    json project = load_project_config();
+    std::string variant = selected_variant(project, "");
+
+    // Check with the settings of the first target listing the file
+    std::string target = project_targets(project).front();
+    std::string wanted = fs::absolute(file).lexically_normal().string();
+    for (const auto& candidate : project_targets(project)) {
+        bool found = false;
+        for (const auto& src : project_sources(target_config(project, candidate))) {
+            found = found || fs::absolute(src).lexically_normal().string() == wanted;
+        }
+        if (found) {
+            target = candidate;
+            break;
+        }
+    }
+    json config = target_config(project, target);
+
+    bool c = config["c"];
+    std::string platform = host_platform();
+    std::string compiler = platform_compiler(platform, c);
+    std::string platform_build_dir = variant_buildpath(config, variant) + platform + "/" +
+        (target.empty() ? "" : target + "/");
+    bool modules = config.value("modules", false);
+    CompileUnit unit{file, platform_build_dir + fs::path(file).stem().string() + ".o",
+        target_flags(config, variant, platform, compiler, variant_buildpath(config, variant))};
+    // The baseline build of a multiarch source is rewritten, so it skips LTO
+    if (platform == "linux" && !modules && !multiarch_levels(config).empty() &&
+        is_multiarch_source(config, file) && !lto_mode(config, variant).empty()) {
+        unit.flags.push_back("-fno-lto");
+    }
+    std::vector<std::string> includes = expand_includes(
+        config.value("includepaths", std::vector<std::string>{"./include/*"}));
+
+    if (!fs::exists(file)) {
+        std::cerr << "❌ File not found: " << file << "\n";
+        return 1;
+    }
+
+    // Reuse the PCH and module interfaces of the last build; a check never
+    // builds them itself
+    std::string pch_header = fs::absolute(platform_build_dir + "pch/" + (c ? "pch.h" : "pch.hpp")).string();
+    if (!config.value("pch", "").empty() && fs::exists(pch_header + ".gch")) {
+        use_pch(unit, pch_header);
+    }
+    if (modules) {
+        std::vector<std::string> extra = module_flags(platform_build_dir);
+        unit.flags.insert(unit.flags.end(), extra.begin(), extra.end());
+    }
+
+    int result;
+    if (object) {
+        fs::create_directories(platform_build_dir);
+        result = compile_all({unit}, compiler, includes, 1, 1).front();
+    } else {
+        std::vector<std::string> args = {"-fsyntax-only", "-fPIC"};
+        if (!language_flag(file).empty()) {
+            args.push_back("-x");
+            args.push_back("c++");
+        }
+        args.push_back(file);
+        args.insert(args.end(), unit.flags.begin(), unit.flags.end());
+        args.insert(args.end(), includes.begin(), includes.end());
+        result = run_cmd(command_line(compiler, args, platform_build_dir + "rsp"));
+    }
+
+    if (result == 0) {
+        std::cout << "✅ " << file << ": no errors\n";
+    } else {
+        std::cout << "❌ " << file << ": check failed\n";
+    }
+    return result == 0 ? 0 : 1;
+}
@@ -9,7 +9,23 @@ void show_help() {
     std::cout << "Commands:\n"
               << "  new <path>      - Creates new project\n"
               << "  build {version} - Builds project and updates version if a new version was provided\n"
+              << "                    (--variant <name> builds one of the configured variants,\n"
+              << "                     --target <name> builds one target and its dependencies)\n"
+              << "  workspace [member...] - Builds workspace.json members and their dependencies\n"
+              << "                    together (--variant <name> builds a variant of each)\n"
               << "  install <path>  - Installs headers from path\n"
+              << "  affected <file> - Lists sources that include the given files\n"
+              << "  run [args]      - Builds the host binary if needed and runs it with args\n"
+              << "                    (--variant <name> runs a configured variant, --target <name> picks the target)\n"
+              << "  pgo [-- args]   - Builds the host binary instrumented, trains it with args and\n"
+              << "                    rebuilds it with the profile (--variant and --target as for run)\n"
+              << "  tune [-- args]  - Builds the host binary with each candidate flag set, benchmarks\n"
+              << "                    it with args and reports the fastest (--runs <n>, --write saves it)\n"
+              << "  size [v1 [v2]]  - Shows the recorded size report of a version, or what grew from v1\n"
+              << "                    to v2 (--target, --platform and --variant pick the output)\n"
+              << "  check <file>    - Syntax-checks one file (--object compiles just its object)\n"
+              << "  watch [--run]   - Rebuilds (and reruns) whenever a source or header changes\n"
+              << "  daemon [stop]   - Keeps build state in memory so later builds start instantly\n"
               << "  update          - Updates the tool to the latest version\n"
               << "  clean           - Removes build directory\n"
               << "  version         - Shows current version\n"
@@ -1,6 +1,13 @@
 #include "../include/dauser/cmd.hpp"
+#include <cstdio>
 #include <iostream>
 #include <string>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 int run_cmd(const std::string& cmd) {
     int result = std::system((cmd + " 2>&1").c_str());
     if (result == 0) {
@@ -10,3 +17,78 @@ int run_cmd(const std::string& cmd) {
         return 1;
     }
 }
+
+int capture_cmd(const std::string& cmd, std::string& output) {
+    output.clear();
+#ifdef _WIN32
+    FILE* pipe = _popen(cmd.c_str(), "r");
+#else
+    FILE* pipe = popen(cmd.c_str(), "r");
+#endif
+    if (!pipe) {
+        return -1;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, n);
+    }
+#ifdef _WIN32
+    return _pclose(pipe);
+#else
+    return pclose(pipe);
+#endif
+}
+
+// argv for program, pointing into args
+static std::vector<char*> program_argv(const std::string& program, const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(program.c_str()));
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    return argv;
+}
+
+int exec_program(const std::string& program, const std::vector<std::string>& args) {
+    std::vector<char*> argv = program_argv(program, args);
+
+    std::cout.flush();
+    std::cerr.flush();
+#ifdef _WIN32
+    intptr_t result = _spawnv(_P_WAIT, program.c_str(), argv.data());
+    if (result != -1) {
+        return static_cast<int>(result);
+    }
+#else
+    execv(program.c_str(), argv.data());
+#endif
+    std::cerr << "❌ Failed to start " << program << "\n";
+    return 127;
+}
+
+int run_program(const std::string& program, const std::vector<std::string>& args) {
+    std::vector<char*> argv = program_argv(program, args);
+
+    std::cout.flush();
+    std::cerr.flush();
+#ifdef _WIN32
+    intptr_t result = _spawnv(_P_WAIT, program.c_str(), argv.data());
+    if (result != -1) {
+        return static_cast<int>(result);
+    }
+#else
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(program.c_str(), argv.data());
+        _exit(127);
+    }
+    int status;
+    if (pid > 0 && waitpid(pid, &status, 0) == pid) {
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+#endif
+    std::cerr << "❌ Failed to start " << program << "\n";
+    return 127;
+}
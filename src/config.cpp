@@ -1,21 +1,258 @@
 #include "../include/dauser/config.hpp"
+#include "../include/dauser/filecache.hpp"
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <functional>
+#include <map>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
-json load_project_config() {
-    std::ifstream file("project.json");
-    if (!file) {
-        throw std::runtime_error("project.json not found.");
+json load_project_config(const std::string& dir) {
+    std::string path = dir.empty() ? "project.json" : (fs::path(dir) / "project.json").string();
+    std::string text;
+    if (!read_file_cached(path, text)) {
+        throw std::runtime_error(path + " not found.");
+    }
+    return json::parse(text);
+}
+
+// Path of a project file as seen from the directory above the project
+static std::string rebase_path(const std::string& dir, const std::string& path) {
+    if (fs::path(path).is_absolute()) {
+        return path;
+    }
+    return (fs::path(dir) / path).lexically_normal().string();
+}
+
+// Rebase the single path fields a project, target or variant object may set
+static void rebase_settings(json& settings, const std::string& dir) {
+    for (const char* key : {"function order", "profile generate", "profile use"}) {
+        if (settings.contains(key) && settings[key] != "") {
+            settings[key] = rebase_path(dir, settings[key]);
+        }
+    }
+}
+
+// Rebase the path fields of a project or target object in place
+static void rebase_fields(json& settings, const std::string& dir) {
+    for (const char* key : {"srcpath", "includepaths", "unity exclude", "multiarch"}) {
+        if (!settings.contains(key)) continue;
+        if (settings[key].is_string()) {
+            settings[key] = rebase_path(dir, settings[key]);
+        } else {
+            for (auto& path : settings[key]) {
+                path = rebase_path(dir, path);
+            }
+        }
+    }
+    if (settings.contains("buildpath")) {
+        settings["buildpath"] = rebase_path(dir, settings["buildpath"]);
+    }
+    if (settings.contains("pch") && settings["pch"] != "" && settings["pch"] != "auto") {
+        settings["pch"] = rebase_path(dir, settings["pch"]);
+    }
+    if (settings.contains("size report") && settings["size report"].is_string() && settings["size report"] != "") {
+        settings["size report"] = rebase_path(dir, settings["size report"]);
+    }
+    rebase_settings(settings, dir);
+    if (settings.contains("variants")) {
+        for (auto& entry : settings["variants"].items()) {
+            rebase_settings(entry.value(), dir);
+        }
+    }
+}
+
+json rebase_config(json config, const std::string& dir) {
+    rebase_fields(config, dir);
+    if (config.contains("targets")) {
+        for (auto& entry : config["targets"].items()) {
+            rebase_fields(entry.value(), dir);
+        }
     }
-    json config;
-    file >> config;
     return config;
 }
 
+std::vector<std::string> project_sources(const json& config) {
+    return config["srcpath"].is_array() ?
+    config["srcpath"].get<std::vector<std::string>>() :
+    std::vector<std::string>{config["srcpath"].get<std::string>()};
+}
+
+std::vector<std::string> config_arguments(const json& config, const std::string& key) {
+    std::vector<std::string> args;
+    if (!config.contains(key)) {
+        return args;
+    }
+    if (config[key].is_string()) {
+        std::istringstream iss(config[key].get<std::string>());
+        std::string arg;
+        while (iss >> arg) args.push_back(arg);
+    } else if (config[key].is_array()) {
+        args = config[key].get<std::vector<std::string>>();
+    }
+    return args;
+}
+
+std::vector<std::string> project_flags(const json& config) {
+    return config_arguments(config, "flags");
+}
+
+std::string selected_variant(const json& config, const std::string& requested) {
+    std::string variant = requested.empty() ? config.value("variant", "") : requested;
+    if (!variant.empty() && !(config.contains("variants") && config["variants"].contains(variant))) {
+        throw std::runtime_error("unknown variant '" + variant + "', add it to \"variants\" in project.json");
+    }
+    return variant;
+}
+
+std::string variant_buildpath(const json& config, const std::string& variant) {
+    std::string buildpath = config["buildpath"];
+    if (variant.empty()) {
+        return buildpath;
+    }
+    if (!buildpath.empty() && buildpath.back() != '/') {
+        buildpath += '/';
+    }
+    return buildpath + variant + "/";
+}
+
+json variant_value(const json& config, const std::string& variant, const std::string& key, const json& fallback) {
+    if (!variant.empty() && config.contains("variants") && config["variants"].contains(variant) &&
+        config["variants"][variant].contains(key)) {
+        return config["variants"][variant][key];
+    }
+    return config.value(key, fallback);
+}
+
+void add_variant(json& config, const std::string& name, const json& variant) {
+    config["variants"][name] = variant;
+    if (config.contains("targets")) {
+        for (auto& entry : config["targets"].items()) {
+            if (entry.value().contains("variants")) {
+                entry.value()["variants"][name] = variant;
+            }
+        }
+    }
+}
+
+std::vector<std::string> variant_flags(const json& config, const std::string& variant) {
+    std::vector<std::string> flags = project_flags(config);
+    if (!variant.empty()) {
+        // A target with "variants" of its own replaces the project's
+        if (!(config.contains("variants") && config["variants"].contains(variant))) {
+            throw std::runtime_error("unknown variant '" + variant + "', add it to \"variants\" in project.json");
+        }
+        std::vector<std::string> extra = project_flags(config["variants"][variant]);
+        flags.insert(flags.end(), extra.begin(), extra.end());
+    }
+    return flags;
+}
+
+std::vector<std::string> project_targets(const json& config) {
+    std::vector<std::string> targets;
+    if (!config.contains("targets")) {
+        return {""};
+    }
+    for (const auto& entry : config["targets"].items()) {
+        targets.push_back(entry.key());
+    }
+    return targets;
+}
+
+json target_config(const json& config, const std::string& target) {
+    if (target.empty()) {
+        return config;
+    }
+    if (!config.contains("targets") || !config["targets"].contains(target)) {
+        throw std::runtime_error("unknown target '" + target + "', add it to \"targets\" in project.json");
+    }
+    json result = config;
+    result.erase("targets");
+    result["name"] = target;
+    result["override binary name"] = false;
+    std::vector<std::string> flags = project_flags(config);
+    std::vector<std::string> includepaths = config.value("includepaths", std::vector<std::string>{"./include/*"});
+    for (const auto& entry : config["targets"][target].items()) {
+        if (entry.key() == "flags") {
+            std::vector<std::string> extra = project_flags(config["targets"][target]);
+            flags.insert(flags.end(), extra.begin(), extra.end());
+        } else if (entry.key() == "includepaths") {
+            std::vector<std::string> extra = entry.value().get<std::vector<std::string>>();
+            includepaths.insert(includepaths.end(), extra.begin(), extra.end());
+        } else {
+            result[entry.key()] = entry.value();
+        }
+    }
+    result["flags"] = flags;
+    result["includepaths"] = includepaths;
+    return result;
+}
+
+std::vector<std::string> target_build_order(const json& config, const std::string& requested) {
+    if (!config.contains("targets")) {
+        if (!requested.empty()) {
+            throw std::runtime_error("project.json has no \"targets\", cannot build target '" + requested + "'");
+        }
+        return {""};
+    }
+    std::vector<std::string> order;
+    std::map<std::string, int> state; // 1 while visiting, 2 once ordered
+    std::function<void(const std::string&)> visit = [&](const std::string& target) {
+        if (!config["targets"].contains(target)) {
+            throw std::runtime_error("unknown target '" + target + "', add it to \"targets\" in project.json");
+        }
+        if (state[target] == 2) return;
+        if (state[target] == 1) {
+            throw std::runtime_error("target '" + target + "' depends on itself");
+        }
+        state[target] = 1;
+        for (const auto& dep : config["targets"][target].value("depends", std::vector<std::string>{})) {
+            visit(dep);
+        }
+        state[target] = 2;
+        order.push_back(target);
+    };
+    if (!requested.empty()) {
+        visit(requested);
+    } else {
+        for (const auto& target : project_targets(config)) {
+            visit(target);
+        }
+    }
+    return order;
+}
+
+std::string run_target(const json& config, const std::string& requested) {
+    if (!requested.empty() || !config.contains("targets")) {
+        return requested;
+    }
+    std::vector<std::string> executables;
+    for (const auto& target : project_targets(config)) {
+        if (target_config(config, target)["type"] == "elf") {
+            executables.push_back(target);
+        }
+    }
+    if (executables.size() != 1) {
+        throw std::runtime_error("cannot tell which target to run, pick one with --target");
+    }
+    return executables.front();
+}
+
 std::vector<std::string> expand_includes(const std::vector<std::string>& raw) {
+    // Directory listings are reused while the build daemon sees no
+    // directories being created or removed
+    static std::map<std::vector<std::string>, std::pair<unsigned long, std::vector<std::string>>> cache;
+    bool use_cache = file_cache_enabled();
+    if (use_cache) {
+        auto it = cache.find(raw);
+        if (it != cache.end() && it->second.first == directory_generation()) {
+            return it->second.second;
+        }
+    }
+    unsigned long generation = directory_generation();
+
     std::vector<std::string> includes;
     for (const std::string& path : raw) {
         if (path.find('*') != std::string::npos) {
@@ -24,6 +261,7 @@ std::vector<std::string> expand_includes(const std::vector<std::string>& raw) {
             if (!base.empty() && base.back() == '/') {
                 base.pop_back();
             }
+            watch_directory(base);
             try {
                 for (auto& entry : fs::directory_iterator(base)) {
                     if (fs::is_directory(entry)) {
@@ -34,6 +272,7 @@ std::vector<std::string> expand_includes(const std::vector<std::string>& raw) {
                 std::cerr << "⚠️ Warning: failed to iterate directory '" << base << "': " << e.what() << "\n";
             }
         } else {
+            watch_directory(fs::path(path).parent_path().string());
             if (fs::is_directory(path)) {
                 includes.push_back("-I" + path);
             } else {
@@ -41,5 +280,8 @@ std::vector<std::string> expand_includes(const std::vector<std::string>& raw) {
             }
         }
     }
+    if (use_cache) {
+        cache[raw] = {generation, includes};
+    }
     return includes;
 }
@@ -0,0 +1,279 @@
+#include "../include/dauser/daemon.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/buildlock.hpp"
+#include "../include/dauser/check.hpp"
+#include "../include/dauser/filecache.hpp"
+#include "../include/dauser/watcher.hpp"
+#include <iostream>
+
+#ifdef _WIN32
+
+int run_daemon() {
+    std::cerr << "❌ The build daemon is only supported on Linux\n";
+    return 1;
+}
+
+std::string build_request(const BuildOptions&) {
+    return "";
+}
+
+bool daemon_request(const std::string&, int&) {
+    return false;
+}
+
+#else
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char* socket_path = ".jmakepp.sock";
+
+static int connect_socket() {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool write_all(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string build_request(const BuildOptions& options) {
+    return "build\t" + options.version + "\t" + options.platform + "\t" + options.variant + "\t" + options.target;
+}
+
+static BuildOptions parse_build_request(const std::string& argument) {
+    BuildOptions options;
+    std::string* fields[] = {&options.version, &options.platform, &options.variant, &options.target};
+    size_t start = 0;
+    for (std::string* field : fields) {
+        size_t end = argument.find('\t', start);
+        *field = argument.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (end == std::string::npos) break;
+        start = end + 1;
+    }
+    return options;
+}
+
+bool daemon_request(const std::string& request, int& exit_code) {
+    int fd = connect_socket();
+    if (fd < 0) {
+        return false;
+    }
+    if (!write_all(fd, request + "\n")) {
+        close(fd);
+        return false;
+    }
+
+    // Output is streamed as-is; a NUL byte followed by the exit code ends it
+    std::string trailer;
+    bool in_trailer = false;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (ssize_t i = 0; i < n; ++i) {
+            if (in_trailer) {
+                trailer += buffer[i];
+            } else if (buffer[i] == '\0') {
+                in_trailer = true;
+            } else {
+                std::cout.put(buffer[i]);
+            }
+        }
+        std::cout.flush();
+    }
+    close(fd);
+
+    if (!in_trailer) {
+        std::cerr << "❌ Build daemon closed the connection\n";
+        exit_code = 1;
+        return true;
+    }
+    exit_code = std::atoi(trailer.c_str());
+    return true;
+}
+
+// Run fn with stdout and stderr (including child processes) sent to fd
+static int with_output_to(int fd, const std::function<int()>& fn) {
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    int saved_out = dup(1);
+    int saved_err = dup(2);
+    dup2(fd, 1);
+    dup2(fd, 2);
+
+    int code;
+    try {
+        code = fn();
+    } catch (std::exception& e) {
+        std::cerr << "❌ Exception: " << e.what() << "\n";
+        code = 1;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    dup2(saved_out, 1);
+    dup2(saved_err, 2);
+    close(saved_out);
+    close(saved_err);
+    return code;
+}
+
+int run_daemon() {
+#ifndef __linux__
+    std::cerr << "❌ The build daemon is only supported on Linux\n";
+    return 1;
+#else
+    int existing = connect_socket();
+    if (existing >= 0) {
+        close(existing);
+        std::cerr << "❌ A build daemon is already running for this project\n";
+        return 1;
+    }
+    unlink(socket_path);
+
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (server < 0 || bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(server, 8) != 0) {
+        std::cerr << "❌ Failed to open " << socket_path << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    FileWatcher watcher;
+    if (!watcher.ok()) {
+        std::cerr << "❌ inotify is not available: " << std::strerror(errno) << "\n";
+        close(server);
+        unlink(socket_path);
+        return 1;
+    }
+
+    // Apply every queued change; runs before each request and whenever the
+    // builder finished writing files
+    auto drain_events = [&]() {
+        bool overflow;
+        watcher.drain(overflow);
+    };
+    enable_file_cache([&](const std::string& dir) { return watcher.add(dir); }, drain_events);
+
+    std::signal(SIGPIPE, SIG_IGN);
+    std::cout << "🛰️ Build daemon listening on " << socket_path << " (stop with: jmakepp daemon stop)\n";
+
+    auto accept_client = [&](std::deque<std::pair<int, std::string>>& queue) {
+        int client = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            return;
+        }
+        std::string request;
+        char ch;
+        while (read(client, &ch, 1) == 1 && ch != '\n') {
+            request += ch;
+        }
+        queue.push_back({client, request});
+    };
+
+    std::deque<std::pair<int, std::string>> queue;
+    bool running = true;
+    while (running) {
+        if (queue.empty()) {
+            pollfd fds[2] = {{server, POLLIN, 0}, {watcher.fd(), POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (fds[1].revents & POLLIN) {
+                drain_events();
+            }
+            if (fds[0].revents & POLLIN) {
+                accept_client(queue);
+            }
+            continue;
+        }
+
+        int client = queue.front().first;
+        std::string request = queue.front().second;
+        queue.pop_front();
+        drain_events();
+
+        std::string command = request.substr(0, request.find('\t'));
+        std::string argument = request.find('\t') == std::string::npos ? "" : request.substr(request.find('\t') + 1);
+        int code = 0;
+        if (command == "build") {
+            std::cout << "🔨 build " << argument << "\n";
+            BuildOptions options = parse_build_request(argument);
+            code = with_output_to(client, [&]() { return coalesced_build(options) ? 0 : 1; });
+
+            // Clients that asked for the same build while it ran share its result
+            pollfd pending = {server, POLLIN, 0};
+            while (poll(&pending, 1, 0) > 0) {
+                accept_client(queue);
+            }
+            for (auto it = queue.begin(); it != queue.end();) {
+                if (it->second != request) {
+                    ++it;
+                    continue;
+                }
+                write_all(it->first, std::string("⏭️ Joined a build that was already running: ") +
+                    (code == 0 ? "✅ succeeded\n" : "❌ failed\n"));
+                write_all(it->first, std::string(1, '\0') + std::to_string(code));
+                close(it->first);
+                it = queue.erase(it);
+            }
+        } else if (command == "check" || command == "check-object") {
+            code = with_output_to(client, [&]() { return check_file(argument, command == "check-object"); });
+        } else if (command == "stop") {
+            write_all(client, "🛑 Build daemon stopped\n");
+            running = false;
+        } else {
+            write_all(client, "❌ Unknown daemon request: " + command + "\n");
+            code = 1;
+        }
+        write_all(client, std::string(1, '\0') + std::to_string(code));
+        close(client);
+    }
+
+    for (const auto& waiting : queue) {
+        write_all(waiting.first, "🛑 Build daemon stopped\n");
+        write_all(waiting.first, std::string(1, '\0') + "1");
+        close(waiting.first);
+    }
+    close(server);
+    unlink(socket_path);
+    return 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "../include/dauser/deps.hpp"
+#include "../include/dauser/filecache.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> read_depfile(const std::string& depfile) {
+    std::vector<std::string> deps;
+    std::string text;
+    if (!read_file_cached(depfile, text)) {
+        return deps;
+    }
+
+    // Split on unescaped whitespace; "\<newline>" is a line continuation
+    // and "\ " is a space inside a path
+    std::vector<std::string> tokens;
+    std::string token;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char ch = text[i];
+        if (ch == '\\' && i + 1 < text.size()) {
+            char next = text[i + 1];
+            if (next == '\n' || next == '\r') {
+                ++i;
+                if (next == '\r' && i + 1 < text.size() && text[i + 1] == '\n') ++i;
+                if (!token.empty()) tokens.push_back(token);
+                token.clear();
+                continue;
+            }
+            if (next == ' ' || next == '#') {
+                token += next;
+                ++i;
+                continue;
+            }
+        }
+        if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+            if (!token.empty()) tokens.push_back(token);
+            token.clear();
+            continue;
+        }
+        token += ch;
+    }
+    if (!token.empty()) tokens.push_back(token);
+
+    // Everything after the first "target:" token is a prerequisite
+    bool seen_target = false;
+    for (const auto& t : tokens) {
+        if (!seen_target) {
+            if (t.back() == ':') seen_target = true;
+            continue;
+        }
+        if (t.back() == ':') break; // -MP phony targets follow the real rule
+        deps.push_back(t);
+    }
+    return deps;
+}
+
+bool object_up_to_date(const std::string& obj_file, const std::string& signature,
+    const std::vector<std::string>& extra_deps
+) {
+    fs::file_time_type obj_time;
+    if (!file_mtime(obj_file, obj_time)) {
+        return false;
+    }
+
+    std::string recorded;
+    if (!read_file_cached(obj_file + ".cmd", recorded) || recorded != signature) {
+        return false;
+    }
+
+    std::vector<std::string> deps = read_depfile(fs::path(obj_file).replace_extension(".d").string());
+    if (deps.empty()) {
+        return false;
+    }
+    deps.insert(deps.end(), extra_deps.begin(), extra_deps.end());
+
+    for (const auto& dep : deps) {
+        fs::file_time_type dep_time;
+        if (!file_mtime(dep, dep_time) || dep_time > obj_time) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool output_up_to_date(const std::string& output, const std::string& stamp,
+    const std::string& signature, const std::vector<std::string>& inputs
+) {
+    fs::file_time_type out_time;
+    if (!file_mtime(output, out_time)) {
+        return false;
+    }
+
+    std::string recorded;
+    if (!read_file_cached(stamp + ".cmd", recorded) || recorded != signature) {
+        return false;
+    }
+
+    for (const auto& input : inputs) {
+        fs::file_time_type input_time;
+        if (!file_mtime(input, input_time) || input_time > out_time) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string content_hash(const std::string& text) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned char ch : text) {
+        hash ^= ch;
+        hash *= 1099511628211ULL;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", hash);
+    return hex;
+}
+
+void write_signature(const std::string& obj_file, const std::string& signature) {
+    std::ofstream out(obj_file + ".cmd", std::ios::trunc);
+    out << signature;
+}
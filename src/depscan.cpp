@@ -0,0 +1,202 @@
+#include "../include/dauser/depscan.hpp"
+#include "../include/dauser/config.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static std::string normalize(const fs::path& path) {
+    return fs::absolute(path).lexically_normal().string();
+}
+
+// Whether position at lies inside a string literal opened on the same line
+static bool in_string(const char* from, const char* at) {
+    bool open = false;
+    for (const char* c = static_cast<const char*>(std::memchr(from, '"', at - from)); c;
+         c = static_cast<const char*>(std::memchr(c + 1, '"', at - c - 1))) {
+        if (c > from && c[-1] == '\\') continue;
+        if (c > from && c[-1] == '\'' && c + 1 < at && c[1] == '\'') continue;
+        open = !open;
+    }
+    return open;
+}
+
+IncludeScanner::IncludeScanner(const std::vector<std::string>& includes) {
+    for (const auto& inc : includes) {
+        if (inc.rfind("-I", 0) == 0) {
+            dirs.push_back(inc.substr(2));
+        }
+    }
+}
+
+std::string IncludeScanner::resolve(const std::string& name, bool quoted, const std::string& from) const {
+    std::error_code ec;
+    if (quoted) {
+        fs::path local = fs::path(from).parent_path() / name;
+        if (fs::is_regular_file(local, ec)) {
+            return normalize(local);
+        }
+    }
+    for (const auto& dir : dirs) {
+        fs::path candidate = fs::path(dir) / name;
+        if (fs::is_regular_file(candidate, ec)) {
+            return normalize(candidate);
+        }
+    }
+    return "";
+}
+
+const std::vector<std::string>& IncludeScanner::direct(const std::string& file) {
+    std::string key = normalize(file);
+    auto cached = cache.find(key);
+    if (cached != cache.end()) {
+        return cached->second;
+    }
+    std::vector<std::string>& found = cache[key];
+
+    std::ifstream in(key, std::ios::binary);
+    if (!in) {
+        return found;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    // One entry per open #if: whether its current branch is active and
+    // whether any branch was taken yet
+    struct Cond { bool active; bool taken; };
+    std::vector<Cond> conds;
+    auto active = [&]() { return conds.empty() || conds.back().active; };
+    auto parent_active = [&]() { return conds.size() < 2 || conds[conds.size() - 2].active; };
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+
+        const char* q = p;
+        while (q < eol && (*q == ' ' || *q == '\t')) ++q;
+
+        if (q < eol && *q == '#') {
+            ++q;
+            while (q < eol && (*q == ' ' || *q == '\t')) ++q;
+            const char* word = q;
+            while (q < eol && std::isalpha(static_cast<unsigned char>(*q))) ++q;
+            std::string directive(word, q);
+            while (q < eol && (*q == ' ' || *q == '\t')) ++q;
+
+            if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+                // Only literal #if 0 / #if 1 are evaluated; anything else
+                // is treated as active so no dependency is missed
+                bool value = true;
+                if (directive == "if" && q < eol && (*q == '0' || *q == '1') &&
+                    (q + 1 == eol || !std::isalnum(static_cast<unsigned char>(q[1])))) {
+                    value = *q == '1';
+                }
+                bool on = active() && value;
+                conds.push_back({on, on});
+            } else if (directive == "elif" && !conds.empty()) {
+                conds.back().active = parent_active() && !conds.back().taken;
+                conds.back().taken = conds.back().taken || conds.back().active;
+            } else if (directive == "else" && !conds.empty()) {
+                conds.back().active = parent_active() && !conds.back().taken;
+                conds.back().taken = true;
+            } else if (directive == "endif" && !conds.empty()) {
+                conds.pop_back();
+            } else if ((directive == "include" || directive == "import") && active() && q < eol) {
+                char close = *q == '"' ? '"' : *q == '<' ? '>' : 0;
+                if (close) {
+                    const char* name_end = static_cast<const char*>(std::memchr(q + 1, close, eol - q - 1));
+                    if (name_end) {
+                        std::string path = resolve(std::string(q + 1, name_end), close == '"', key);
+                        if (!path.empty()) {
+                            found.push_back(path);
+                        }
+                    }
+                }
+            }
+        } else {
+            // Skip block comments so commented-out directives are ignored
+            const char* segment = q;
+            const char* slash = static_cast<const char*>(std::memchr(q, '/', eol - q));
+            while (slash && slash + 1 < eol) {
+                if (slash[1] == '/' && !in_string(segment, slash)) break;
+                if (slash[1] == '*' && !in_string(segment, slash)) {
+                    const char* close = slash + 2;
+                    const char* star = nullptr;
+                    while ((star = static_cast<const char*>(std::memchr(close, '*', end - close)))) {
+                        if (star + 1 < end && star[1] == '/') break;
+                        close = star + 1;
+                    }
+                    if (!star) {
+                        return found;
+                    }
+                    segment = star + 2;
+                    eol = static_cast<const char*>(std::memchr(segment, '\n', end - segment));
+                    if (!eol) eol = end;
+                    slash = static_cast<const char*>(std::memchr(star + 2, '/', eol - star - 2));
+                    continue;
+                }
+                slash = static_cast<const char*>(std::memchr(slash + 1, '/', eol - slash - 1));
+            }
+        }
+        p = (eol == end) ? end : eol + 1;
+    }
+    return found;
+}
+
+std::vector<std::string> IncludeScanner::dependencies(const std::string& source) {
+    std::vector<std::string> result;
+    std::set<std::string> seen;
+    std::vector<std::string> pending = {normalize(source)};
+    seen.insert(pending.front());
+    while (!pending.empty()) {
+        std::string file = pending.back();
+        pending.pop_back();
+        for (const auto& header : direct(file)) {
+            if (seen.insert(header).second) {
+                result.push_back(header);
+                pending.push_back(header);
+            }
+        }
+    }
+    return result;
+}
+
+void show_affected(const std::vector<std::string>& changed) {
+    json config = load_project_config();
+
+    std::set<std::string> targets;
+    for (const auto& file : changed) {
+        targets.insert(normalize(file));
+    }
+
+    // Sources shared by several build targets are listed once
+    std::set<std::string> listed;
+    for (const auto& target : project_targets(config)) {
+        json settings = target_config(config, target);
+        std::vector<std::string> includepaths = settings.value("includepaths", std::vector<std::string>{"./include/*"});
+        IncludeScanner scanner(expand_includes(includepaths));
+        for (const auto& src : project_sources(settings)) {
+            if (listed.count(normalize(src))) continue;
+            bool hit = targets.count(normalize(src)) > 0;
+            if (!hit) {
+                for (const auto& dep : scanner.dependencies(src)) {
+                    if (targets.count(dep)) {
+                        hit = true;
+                        break;
+                    }
+                }
+            }
+            if (hit) {
+                listed.insert(normalize(src));
+                std::cout << src << "\n";
+            }
+        }
+    }
+}
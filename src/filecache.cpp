@@ -0,0 +1,161 @@
+#include "../include/dauser/filecache.hpp"
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct Stat {
+        bool exists;
+        fs::file_time_type time;
+    };
+
+    std::mutex cache_mutex;
+    bool enabled = false;
+    std::function<bool(const std::string&)> watch_hook;
+    std::function<void()> sync_hook;
+    std::string cwd;
+    std::set<std::string> watched;
+    std::map<std::string, Stat> stats;
+    std::map<std::string, std::string> contents_cache;
+    unsigned long dir_generation = 0;
+
+    std::string cache_key(const std::string& path) {
+        fs::path p(path);
+        if (p.is_relative()) {
+            p = fs::path(cwd) / p;
+        }
+        return p.lexically_normal().string();
+    }
+
+    // Whether changes to the directory holding key are reported.
+    // Caller holds cache_mutex.
+    bool ensure_watched(const std::string& dir) {
+        if (watched.count(dir)) {
+            return true;
+        }
+        if (!watch_hook || !watch_hook(dir)) {
+            return false;
+        }
+        watched.insert(dir);
+        return true;
+    }
+
+    std::string parent_dir(const std::string& key) {
+        return fs::path(key).parent_path().string();
+    }
+}
+
+void enable_file_cache(std::function<bool(const std::string&)> watch, std::function<void()> sync) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    enabled = true;
+    watch_hook = watch;
+    sync_hook = sync;
+    cwd = fs::current_path().string();
+}
+
+bool file_cache_enabled() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return enabled;
+}
+
+void sync_file_cache() {
+    std::function<void()> hook;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (!enabled) return;
+        hook = sync_hook;
+    }
+    if (hook) hook();
+}
+
+bool file_mtime(const std::string& path, fs::file_time_type& time) {
+    std::unique_lock<std::mutex> lock(cache_mutex);
+    std::error_code ec;
+    if (!enabled) {
+        lock.unlock();
+        time = fs::last_write_time(path, ec);
+        return !ec;
+    }
+
+    std::string key = cache_key(path);
+    auto it = stats.find(key);
+    if (it != stats.end()) {
+        time = it->second.time;
+        return it->second.exists;
+    }
+    Stat stat;
+    bool watched_dir = ensure_watched(parent_dir(key));
+    stat.time = fs::last_write_time(key, ec);
+    stat.exists = !ec;
+    if (watched_dir) {
+        stats.emplace(key, stat);
+    }
+    time = stat.time;
+    return stat.exists;
+}
+
+bool read_file_cached(const std::string& path, std::string& contents) {
+    std::unique_lock<std::mutex> lock(cache_mutex);
+    bool use_cache = enabled;
+    std::string key = use_cache ? cache_key(path) : path;
+    if (use_cache) {
+        auto it = contents_cache.find(key);
+        if (it != contents_cache.end()) {
+            contents = it->second;
+            return true;
+        }
+        use_cache = ensure_watched(parent_dir(key));
+    } else {
+        lock.unlock();
+    }
+
+    std::ifstream file(key, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    contents = ss.str();
+
+    if (use_cache) {
+        contents_cache[key] = contents;
+    }
+    return true;
+}
+
+void watch_directory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!enabled) {
+        return;
+    }
+    ensure_watched(cache_key(dir));
+}
+
+void invalidate_file(const std::string& path) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::string key = cache_key(path);
+    stats.erase(key);
+    contents_cache.erase(key);
+}
+
+void invalidate_file_cache() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    stats.clear();
+    contents_cache.clear();
+    watched.clear();
+    ++dir_generation;
+}
+
+unsigned long directory_generation() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return dir_generation;
+}
+
+void bump_directory_generation() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    ++dir_generation;
+}
@@ -0,0 +1,291 @@
+#include "../include/dauser/linker.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/deps.hpp"
+#include "../include/dauser/filecache.hpp"
+#include "../include/dauser/filio.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <mutex>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::mutex probe_mutex;
+    std::map<std::string, std::string> probed; // compiler -> linker
+
+    // Fastest first
+    const char* candidates[] = {"mold", "lld", "gold"};
+
+    bool linker_works(const std::string& compiler, const std::string& linker) {
+#ifdef _WIN32
+        std::string quiet = " >NUL 2>&1";
+#else
+        std::string quiet = " >/dev/null 2>&1";
+#endif
+        return std::system((compiler + " -fuse-ld=" + linker + " -Wl,--version" + quiet).c_str()) == 0;
+    }
+}
+
+std::string select_linker(const json& config, const std::string& platform, const std::string& compiler) {
+    if (config.contains("linker")) {
+        const json& linker = config["linker"];
+        if (linker.is_string()) {
+            return linker.get<std::string>();
+        }
+        if (linker.is_object() && linker.contains(platform)) {
+            return linker[platform].get<std::string>();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(probe_mutex);
+    auto it = probed.find(compiler);
+    if (it != probed.end()) {
+        return it->second;
+    }
+
+    // One line per compiler: "<compiler> <linker>"
+    std::string cache_file = config["buildpath"].get<std::string>() + "/linkers.cache";
+    {
+        std::ifstream in(cache_file);
+        std::string name, linker;
+        while (in >> name >> linker) {
+            probed[name] = linker;
+        }
+    }
+    it = probed.find(compiler);
+    if (it != probed.end()) {
+        return it->second;
+    }
+
+    std::string found = "default";
+    for (const char* candidate : candidates) {
+        if (linker_works(compiler, candidate)) {
+            found = candidate;
+            break;
+        }
+    }
+    std::cout << "🔎 Linker for " << compiler << ": " << found << "\n";
+    probed[compiler] = found;
+    fs::create_directories(config["buildpath"].get<std::string>());
+    std::ofstream out(cache_file, std::ios::app);
+    out << compiler << " " << found << "\n";
+    return found;
+}
+
+std::string lto_mode(const json& settings, const std::string& variant) {
+    json lto = variant_value(settings, variant, "lto", false);
+    if (lto.is_boolean()) {
+        return lto.get<bool>() ? "full" : "";
+    }
+    std::string mode = lto.get<std::string>();
+    if (mode != "" && mode != "full" && mode != "thin") {
+        throw std::runtime_error("unknown lto mode '" + mode + "', use \"full\" or \"thin\"");
+    }
+    return mode;
+}
+
+bool is_clang(const std::string& compiler) {
+    return compiler.find("clang") != std::string::npos;
+}
+
+std::vector<std::string> lto_compile_flags(const std::string& mode, const std::string& compiler) {
+    if (mode.empty()) {
+        return {};
+    }
+    if (is_clang(compiler) && mode == "thin") {
+        return {"-flto=thin"};
+    }
+    return {"-flto"};
+}
+
+std::vector<std::string> lto_link_flags(const std::string& mode, const std::string& compiler,
+    const std::string& linker, const std::string& platform, int jobs, const std::string& cache_dir
+) {
+    if (mode.empty()) {
+        return {};
+    }
+    std::string count = std::to_string(jobs < 1 ? 1 : jobs);
+    if (!is_clang(compiler)) {
+        // An explicit count instead of -flto=auto, which would take every core
+        return {"-flto=" + count};
+    }
+    if (mode != "thin") {
+        return {"-flto"};
+    }
+    if (platform == "macos") {
+        return {"-flto=thin", "-Wl,-mllvm,-threads=" + count, "-Wl,-cache_path_lto," + cache_dir};
+    }
+    if (linker == "lld") {
+        return {"-flto=thin", "-Wl,--thinlto-jobs=" + count, "-Wl,--thinlto-cache-dir=" + cache_dir};
+    }
+    return {"-flto=thin", "-Wl,-plugin-opt,jobs=" + count, "-Wl,-plugin-opt,cache-dir=" + cache_dir};
+}
+
+int lto_link_weight(const std::string& mode, const std::string& compiler, int jobs) {
+    if (mode.empty() || (is_clang(compiler) && mode != "thin")) {
+        return 1;
+    }
+    return jobs < 1 ? 1 : jobs;
+}
+
+std::string lto_archiver(const std::string& platform, const std::string& compiler) {
+    if (is_clang(compiler)) {
+        return "llvm-ar";
+    }
+    return platform == "windows" ? "x86_64-w64-mingw32-gcc-ar" : "gcc-ar";
+}
+
+std::vector<std::string> linker_flags(const std::string& linker, int threads) {
+    if (linker.empty() || linker == "default") {
+        return {};
+    }
+    std::vector<std::string> flags = {"-fuse-ld=" + linker};
+    if (threads < 1) {
+        return flags;
+    }
+    std::string count = std::to_string(threads);
+    if (linker == "mold") {
+        flags.push_back("-Wl,--thread-count=" + count);
+    } else if (linker == "lld") {
+        flags.push_back("-Wl,--threads=" + count);
+    } else if (linker == "gold") {
+        flags.push_back("-Wl,--threads,--thread-count," + count);
+    }
+    return flags;
+}
+
+int linker_weight(const std::string& linker, int threads) {
+    bool threaded = linker == "mold" || linker == "lld" || linker == "gold";
+    return threaded && threads > 1 ? threads : 1;
+}
+
+int default_link_threads(const std::string& linker, int max_threads) {
+    if (linker == "gold") {
+        return 1;
+    }
+    return std::max(1, max_threads / 4);
+}
+
+std::string function_order_profile(const json& settings, const std::string& variant) {
+    return variant_value(settings, variant, "function order", "").get<std::string>();
+}
+
+std::vector<std::string> hot_functions(const std::string& profile) {
+    std::string text;
+    if (fs::path(profile).extension() == ".data") {
+        // Symbol of every sample, mangled as the linker knows it
+        if (capture_cmd("perf script --no-demangle -F sym -i \"" + profile + "\" 2>/dev/null", text) != 0) {
+            return {};
+        }
+    } else {
+        text = filio::read(profile);
+    }
+
+    std::map<std::string, long long> samples;
+    std::vector<std::string> seen;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string first, symbol;
+        if (!(fields >> first)) continue;
+        long long count = 1;
+        if (fields >> symbol) {
+            try {
+                count = std::stoll(first);
+            } catch (const std::exception&) {
+                continue;
+            }
+        } else {
+            symbol = first;
+        }
+        if (symbol == "[unknown]") continue;
+        if (samples.find(symbol) == samples.end()) seen.push_back(symbol);
+        samples[symbol] += count;
+    }
+    // Ties keep the order the profile named them in
+    std::stable_sort(seen.begin(), seen.end(), [&](const std::string& a, const std::string& b) {
+        return samples[a] > samples[b];
+    });
+    return seen;
+}
+
+std::vector<std::string> function_order_flags(const std::string& profile, const std::string& linker,
+    const std::string& platform, const std::string& order_file
+) {
+    if (!fs::exists(profile)) {
+        std::cout << "⚠️ Function order profile " << profile << " not found, linking unordered\n";
+        return {};
+    }
+    // Each linker names the functions differently: ld64 by C symbol, gold by section
+    std::string prefix;
+    std::vector<std::string> flags;
+    if (platform == "macos") {
+        prefix = "_";
+        flags = {"-Wl,-order_file," + order_file};
+    } else if (linker == "lld") {
+        // Profiled symbols from other libraries are expected, not worth a warning each
+        flags = {"-Wl,--symbol-ordering-file=" + order_file, "-Wl,--no-warn-symbol-ordering"};
+    } else if (linker == "mold") {
+        flags = {"-Wl,--symbol-ordering-file=" + order_file};
+    } else if (linker == "gold") {
+        prefix = ".text.";
+        flags = {"-Wl,--section-ordering-file=" + order_file};
+    } else {
+        std::cout << "⚠️ The " << linker << " linker cannot order functions, use mold, lld or gold\n";
+        return {};
+    }
+
+    std::string contents;
+    for (const auto& function : hot_functions(profile)) {
+        contents += prefix + function + "\n";
+    }
+    if (!fs::exists(order_file) || filio::read(order_file) != contents) {
+        filio::write(order_file, contents);
+    }
+    return flags;
+}
+
+// DWARF packager: llvm-dwp where installed, since the binutils dwp does not read DWARF 5
+static const std::string& dwarf_packager() {
+    static const std::string packager = std::system("llvm-dwp --version >/dev/null 2>&1") == 0 ? "llvm-dwp" : "dwp";
+    return packager;
+}
+
+int separate_debug_info(const std::string& output, const std::string& stamp, bool package_dwo, bool separate) {
+    std::string signature = std::string("debug") + (package_dwo ? " dwp" : "") + (separate ? " separate" : "");
+    bool present = (!package_dwo || fs::exists(output + ".dwp")) && (!separate || fs::exists(output + ".debug"));
+    if (present && output_up_to_date(stamp + ".cmd", stamp, signature, {output})) {
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cout << "🪶 Splitting debug info: " << output << "\n";
+    }
+    if (package_dwo) {
+        if (run_cmd(dwarf_packager() + " -e \"" + output + "\" -o \"" + output + ".dwp\"") != 0) {
+            return 1;
+        }
+        if (separate && run_cmd("objcopy --compress-debug-sections=zlib \"" + output + ".dwp\"") != 0) {
+            return 1;
+        }
+    }
+    if (separate) {
+        // The debug link records only the file name; debuggers look next to output
+        if (run_cmd("objcopy --only-keep-debug --compress-debug-sections=zlib \"" + output + "\" \"" + output + ".debug\"") != 0 ||
+            run_cmd("objcopy --strip-debug --add-gnu-debuglink=\"" + output + ".debug\" \"" + output + "\"") != 0) {
+            return 1;
+        }
+        invalidate_file(output);
+    }
+    write_signature(stamp, signature);
+    invalidate_file(stamp + ".cmd");
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include "../include/dauser/config.hpp"
 #include "../include/dauser/builder.hpp"
+#include "../include/dauser/buildlock.hpp"
 #include "../include/dauser/installer.hpp"
 #include "../include/dauser/project.hpp"
 #include "../include/dauser/updater.hpp"
@@ -10,6 +11,14 @@
 #include "../include/dauser/cli.hpp"
 #include "../include/dauser/platform.hpp"
 #include "../include/dauser/cmd.hpp"
+#include "../include/dauser/depscan.hpp"
+#include "../include/dauser/daemon.hpp"
+#include "../include/dauser/watch.hpp"
+#include "../include/dauser/check.hpp"
+#include "../include/dauser/workspace.hpp"
+#include "../include/dauser/pgo.hpp"
+#include "../include/dauser/tune.hpp"
+#include "../include/dauser/size.hpp"
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
@@ -21,16 +30,99 @@ int main(int argc, char* argv[]) {
 
     try {
         if (cmd == "build") {
-            if (argc < 1) {
-                std::cout << "Usage: jmakepp build {new_version}";
-                return 1;
+            // jmakepp build [version] [--variant <name>] [--target <name>]
+            BuildOptions options;
+            for (int i = 2; i < argc; ++i) {
+                std::string arg = argv[i];
+                if (arg == "--variant" && i + 1 < argc) {
+                    options.variant = argv[++i];
+                } else if (arg == "--target" && i + 1 < argc) {
+                    options.target = argv[++i];
+                } else {
+                    options.version = arg;
+                }
             }
-            try{
-                std::string temp = argv[2];
-                build(temp);
-            }catch(const std::exception& e){
-                build("");
+            int code;
+            if (daemon_request(build_request(options), code)) {
+                return code;
+            }
+            return coalesced_build(options) ? 0 : 1;
+        } else if (cmd == "workspace") {
+            // jmakepp workspace [member...] [--variant <name>]
+            std::vector<std::string> members;
+            std::string variant;
+            for (int i = 2; i < argc; ++i) {
+                std::string arg = argv[i];
+                if (arg == "--variant" && i + 1 < argc) {
+                    variant = argv[++i];
+                } else {
+                    members.push_back(arg);
+                }
             }
+            return build_workspace(members, variant) ? 0 : 1;
+        } else if (cmd == "pgo") {
+            // jmakepp pgo [--variant <name>] [--target <name>] [-- training args...]
+            std::string variant;
+            std::string target;
+            std::vector<std::string> args;
+            for (int i = 2; i < argc; ++i) {
+                std::string arg = argv[i];
+                if (arg == "--variant" && i + 1 < argc) {
+                    variant = argv[++i];
+                } else if (arg == "--target" && i + 1 < argc) {
+                    target = argv[++i];
+                } else {
+                    if (arg == "--") ++i;
+                    args.assign(argv + i, argv + argc);
+                    break;
+                }
+            }
+            return run_pgo(target, variant, args) ? 0 : 1;
+        } else if (cmd == "tune") {
+            // jmakepp tune [--target <name>] [--runs <n>] [--write] [-- benchmark args...]
+            std::string target;
+            int runs = 0;
+            bool write = false;
+            std::vector<std::string> args;
+            for (int i = 2; i < argc; ++i) {
+                std::string arg = argv[i];
+                if (arg == "--target" && i + 1 < argc) {
+                    target = argv[++i];
+                } else if (arg == "--runs" && i + 1 < argc) {
+                    runs = std::stoi(argv[++i]);
+                } else if (arg == "--write") {
+                    write = true;
+                } else {
+                    if (arg == "--") ++i;
+                    args.assign(argv + i, argv + argc);
+                    break;
+                }
+            }
+            return run_tune(target, runs, write, args) ? 0 : 1;
+        } else if (cmd == "size") {
+            // jmakepp size [version [other version]] [--target <name>] [--platform <name>] [--variant <name>]
+            std::vector<std::string> versions;
+            std::string target;
+            std::string platform = host_platform();
+            std::string variant;
+            for (int i = 2; i < argc; ++i) {
+                std::string arg = argv[i];
+                if (arg == "--target" && i + 1 < argc) {
+                    target = argv[++i];
+                } else if (arg == "--platform" && i + 1 < argc) {
+                    platform = argv[++i];
+                } else if (arg == "--variant" && i + 1 < argc) {
+                    variant = argv[++i];
+                } else {
+                    versions.push_back(arg);
+                }
+            }
+            if (versions.size() > 2) {
+                std::cout << "Usage: jmakepp size [version [other version]]\n";
+                return 1;
+            }
+            versions.resize(2);
+            return show_size(versions[0], versions[1], target, platform, variant) ? 0 : 1;
         } else if (cmd == "new") {
             if (argc < 3) {
                 std::cout << "Usage: jmakepp new <path>\n";
@@ -43,6 +135,12 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             install_headers(argv[2]);
+        } else if (cmd == "affected") {
+            if (argc < 3) {
+                std::cout << "Usage: jmakepp affected <file>...\n";
+                return 1;
+            }
+            show_affected(std::vector<std::string>(argv + 2, argv + argc));
         } else if (cmd == "help") {
             show_help();
         } else if(cmd == "version") {
@@ -61,22 +159,65 @@ int main(int argc, char* argv[]) {
             else {
                 std::cout << "⚠️ Build directory does not exist\n";
             }
+        } else if (cmd == "check") {
+            bool object = argc > 2 && std::string(argv[2]) == "--object";
+            if (argc < (object ? 4 : 3)) {
+                std::cout << "Usage: jmakepp check [--object] <file>\n";
+                return 1;
+            }
+            std::string file = argv[object ? 3 : 2];
+            int code;
+            if (daemon_request((object ? "check-object\t" : "check\t") + file, code)) {
+                return code;
+            }
+            return check_file(file, object);
+        } else if (cmd == "watch") {
+            bool run = argc > 2 && std::string(argv[2]) == "--run";
+            return watch_project(run);
+        } else if (cmd == "daemon") {
+            if (argc > 2 && std::string(argv[2]) == "stop") {
+                int code;
+                if (!daemon_request("stop", code)) {
+                    std::cout << "⚠️ No build daemon is running\n";
+                    return 1;
+                }
+                return code;
+            }
+            return run_daemon();
         } else if (cmd == "update") {
             update(filio::extra::script_path().string());
-        }else if(cmd == "run"){
-                json config = load_project_config();
-                build(config["version"]);
-                if(config["override binary name"]){
-                    std::string buildpath = config["buildpath"];
-                    std::string binary_name = config["binary name"];
-                    run_cmd(buildpath + "" + binary_name + (is_windows?"_windows.exe":is_macos?"_macos":"_linux"));
-                }else{
-                    std::string version = config["version"];
-                    std::string buildpath = config["buildpath"];
-                    std::string name = config["name"];
-                    run_cmd(buildpath + name + "-" + version + (is_windows?"-windows.exe":is_macos?"-macos":"-linux"));
+        } else if (cmd == "run") {
+            // Build just the host binary, then replace this process with it
+            BuildOptions options;
+            options.platform = host_platform();
+            int first_arg = 2;
+            while (first_arg + 1 < argc) {
+                std::string arg = argv[first_arg];
+                if (arg == "--variant") {
+                    options.variant = argv[first_arg + 1];
+                } else if (arg == "--target") {
+                    options.target = argv[first_arg + 1];
+                } else {
+                    break;
                 }
+                first_arg += 2;
+            }
+            json config = load_project_config();
+            options.target = run_target(config, options.target);
+            int code;
+            bool built = daemon_request(build_request(options), code) ? code == 0 : coalesced_build(options);
+            if (!built) {
+                return 1;
+            }
+            config = load_project_config();
+            std::vector<std::string> args(argv + first_arg, argv + argc);
+            if (!args.empty() && args.front() == "--") {
+                args.erase(args.begin());
             }
+            std::string variant = selected_variant(config, options.variant);
+            return exec_program(output_path(target_config(config, options.target), options.platform,
+                config["version"], variant), args);
+        }
         else {
             std::cout << "❌ Unknown command: " << cmd << "\n";
             return 1;
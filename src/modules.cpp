@@ -0,0 +1,178 @@
+#include "../include/dauser/modules.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// Remove whitespace inside a module name such as "a . b : part"
+static std::string module_name(const std::string& text) {
+    std::string name;
+    for (char ch : text) {
+        if (ch != ' ' && ch != '\t') name += ch;
+    }
+    return name;
+}
+
+ModuleInfo scan_module_source(const std::string& source_file) {
+    ModuleInfo info;
+    std::ifstream file(source_file);
+    std::string line;
+    std::string module;
+    bool in_comment = false;
+
+    // Module and import declarations must start a line, so a line scan
+    // that skips comments is enough
+    while (std::getline(file, line)) {
+        std::string code;
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (in_comment) {
+                if (line.compare(i, 2, "*/") == 0) {
+                    in_comment = false;
+                    ++i;
+                }
+                continue;
+            }
+            if (line.compare(i, 2, "/*") == 0) {
+                in_comment = true;
+                ++i;
+                continue;
+            }
+            if (line.compare(i, 2, "//") == 0) break;
+            code += line[i];
+        }
+        code = trim(code);
+        if (code.rfind("export ", 0) == 0) {
+            code = trim(code.substr(7));
+        }
+
+        size_t semi = code.find(';');
+        if (semi == std::string::npos) continue;
+
+        if (code.rfind("module ", 0) == 0) {
+            std::string name = module_name(code.substr(7, semi - 7));
+            if (name.empty() || name == ":private") continue;
+            module = name.substr(0, name.find(':'));
+            // Only interfaces and partitions produce a module interface;
+            // "module name;" implementation units import their interface
+            if (line.find("export") != std::string::npos || name.find(':') != std::string::npos) {
+                info.provides = name;
+            } else {
+                info.imports.push_back(name);
+            }
+        } else if (code.rfind("import ", 0) == 0 || code.rfind("import:", 0) == 0) {
+            std::string name = module_name(code.substr(6, semi - 6));
+            if (name.empty() || name[0] == '<' || name[0] == '"') continue; // header units
+            if (name[0] == ':') name = module + name;
+            info.imports.push_back(name);
+        }
+    }
+    return info;
+}
+
+static std::string mapper_path(const std::string& build_dir) {
+    return fs::absolute(build_dir + "modules.map").lexically_normal().string();
+}
+
+std::vector<std::string> module_flags(const std::string& build_dir) {
+    return {"-fmodules-ts", "-fmodule-mapper=" + mapper_path(build_dir)};
+}
+
+bool prepare_modules(std::vector<CompileUnit>& units, const std::string& compiler,
+    const std::string& build_dir, std::vector<std::vector<size_t>>& after
+) {
+    after.assign(units.size(), {});
+    if (compiler.find("clang") != std::string::npos) {
+        std::cerr << "⚠️ Module builds are only supported with g++, modules may fail to compile\n";
+    }
+    std::string cache_dir = fs::absolute(build_dir + "gcm.cache/").lexically_normal().string();
+    fs::create_directories(cache_dir);
+
+    std::vector<ModuleInfo> infos;
+    std::map<std::string, size_t> providers;
+    for (size_t i = 0; i < units.size(); ++i) {
+        infos.push_back(scan_module_source(units[i].source));
+        const std::string& name = infos.back().provides;
+        if (name.empty()) continue;
+        if (providers.count(name)) {
+            std::cerr << "❌ Module '" << name << "' is provided by both " << units[providers[name]].source
+                      << " and " << units[i].source << "\n";
+            return false;
+        }
+        providers[name] = i;
+    }
+
+    auto bmi_path = [&](const std::string& name) {
+        std::string file = name;
+        for (auto& ch : file) {
+            if (ch == ':') ch = '-';
+        }
+        return cache_dir + file + ".gcm";
+    };
+
+    // The mapper tells g++ where each module interface lives; keep it
+    // untouched unless the set of modules changes
+    std::string mapper = mapper_path(build_dir);
+    std::string contents;
+    for (const auto& entry : providers) {
+        contents += entry.first + " " + bmi_path(entry.first) + "\n";
+    }
+    std::stringstream current;
+    {
+        std::ifstream existing(mapper);
+        current << existing.rdbuf();
+    }
+    if (current.str() != contents) {
+        std::ofstream out(mapper, std::ios::trunc);
+        out << contents;
+    }
+
+    for (size_t i = 0; i < units.size(); ++i) {
+        std::vector<std::string> extra = module_flags(build_dir);
+        units[i].flags.insert(units[i].flags.end(), extra.begin(), extra.end());
+        // Importers are stale when an interface they use is rebuilt
+        for (const auto& name : infos[i].imports) {
+            auto it = providers.find(name);
+            if (it != providers.end() && it->second != i) {
+                units[i].deps.push_back(bmi_path(name));
+                after[i].push_back(it->second);
+            }
+        }
+        // An interface whose cached module file went missing must recompile
+        if (!infos[i].provides.empty() && !fs::exists(bmi_path(infos[i].provides))) {
+            std::error_code ec;
+            fs::remove(units[i].object, ec);
+        }
+    }
+
+    // Interfaces compile before their importers, which needs an acyclic graph
+    std::vector<int> state(units.size(), 0);
+    std::function<bool(size_t)> acyclic = [&](size_t i) -> bool {
+        if (state[i] == 2) return true;
+        if (state[i] == 1) {
+            std::cerr << "❌ Module import cycle through " << units[i].source << "\n";
+            return false;
+        }
+        state[i] = 1;
+        for (size_t provider : after[i]) {
+            if (!acyclic(provider)) return false;
+        }
+        state[i] = 2;
+        return true;
+    };
+    for (size_t i = 0; i < units.size(); ++i) {
+        if (!acyclic(i)) return false;
+    }
+    return true;
+}
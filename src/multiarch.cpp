@@ -0,0 +1,272 @@
+#include "../include/dauser/multiarch.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/deps.hpp"
+#include "../include/dauser/filecache.hpp"
+#include "../include/dauser/filio.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::mutex output_mutex;
+
+    const char* known_levels[] = {"x86-64-v2", "x86-64-v3", "x86-64-v4"};
+
+    // Suffix of a level's function names; symbols cannot contain '-'
+    std::string level_tag(const std::string& level) {
+        std::string tag = level;
+        std::replace(tag.begin(), tag.end(), '-', '_');
+        return tag;
+    }
+
+    // Path of object with its extension replaced by suffix
+    std::string sibling(const std::string& object, const std::string& suffix) {
+        return fs::path(object).replace_extension("").string() + suffix;
+    }
+
+    // Symbols an object defines, from nm
+    struct Symbols {
+        std::set<std::string> functions; // global functions
+        std::vector<std::string> data;   // global data
+        std::vector<std::string> statics; // writable namespace-scope data with internal linkage
+    };
+
+    bool defined_symbols(const std::string& object, Symbols& symbols) {
+        std::string output;
+        if (capture_cmd("nm --defined-only -P \"" + object + "\"", output) != 0) {
+            std::cerr << "❌ Could not list the symbols of " << object << "\n";
+            return false;
+        }
+        std::istringstream lines(output);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            std::string name, type;
+            if (!(fields >> name >> type) || type.size() != 1) continue;
+            if (type == "T" && name != "main") {
+                symbols.functions.insert(name);
+            } else if (std::string("BDGRS").find(type[0]) != std::string::npos) {
+                symbols.data.push_back(name);
+            } else if (std::string("bdgs").find(type[0]) != std::string::npos && name[0] != '.' &&
+                name.rfind("_ZZ", 0) != 0 && name.rfind("_ZGV", 0) != 0) {
+                // Function-local statics (_ZZ) and their guards (_ZGV) are set up on first use
+                symbols.statics.push_back(name);
+            }
+        }
+        return true;
+    }
+
+    // Sections that make the loader run code for the object's globals
+    const char* initializer_sections[] = {".init_array*", ".fini_array*", ".ctors*", ".dtors*"};
+
+    // Whether an object runs code when the program loads or exits
+    bool has_initializers(const std::string& object, bool& found) {
+        std::string output;
+        if (capture_cmd("objdump -h \"" + object + "\"", output) != 0) {
+            std::cerr << "❌ Could not list the sections of " << object << "\n";
+            return false;
+        }
+        std::istringstream lines(output);
+        std::string line;
+        found = false;
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            std::string index, name;
+            if (!(fields >> index >> name)) continue;
+            for (const char* section : initializer_sections) {
+                std::string prefix(section, std::strlen(section) - 1);
+                if (name.rfind(prefix, 0) == 0) found = true;
+            }
+        }
+        return true;
+    }
+
+    // Rename functions of object to name.tag and weaken weak_symbols, writing
+    // output. A level build drops its initializers: its globals are the
+    // baseline's, which the baseline already constructs and destroys, and
+    // its code may not run on the CPU at all.
+    int rewrite_object(const std::string& object, const std::string& output, const std::set<std::string>& functions,
+        const std::string& tag, const std::vector<std::string>& weak_symbols, bool level
+    ) {
+        std::string renames;
+        for (const auto& function : functions) {
+            renames += function + " " + function + "." + tag + "\n";
+        }
+        std::string rename_file = output + ".syms";
+        filio::write(rename_file, renames);
+        std::vector<std::string> args = {"--redefine-syms=" + rename_file};
+        if (!weak_symbols.empty()) {
+            std::string weak_file = output + ".weak";
+            std::string weak;
+            for (const auto& symbol : weak_symbols) {
+                weak += symbol + "\n";
+            }
+            filio::write(weak_file, weak);
+            args.push_back("--weaken-symbols=" + weak_file);
+        }
+        if (level) {
+            for (const char* section : initializer_sections) {
+                args.push_back(std::string("--remove-section=") + section);
+            }
+        }
+        args.push_back(object);
+        args.push_back(output);
+        return run_cmd(command_line("objcopy", args, ""));
+    }
+}
+
+std::vector<std::string> multiarch_levels(const json& settings) {
+    if (settings.value("multiarch", std::vector<std::string>{}).empty()) {
+        return {};
+    }
+    std::vector<std::string> levels = settings.value("multiarch levels",
+        std::vector<std::string>(std::begin(known_levels), std::end(known_levels)));
+    for (const auto& level : levels) {
+        if (std::find(std::begin(known_levels), std::end(known_levels), level) == std::end(known_levels)) {
+            throw std::runtime_error("unknown multiarch level '" + level + "', use x86-64-v2, x86-64-v3 or x86-64-v4");
+        }
+    }
+    return levels;
+}
+
+bool is_multiarch_source(const json& settings, const std::string& source) {
+    for (const auto& path : settings.value("multiarch", std::vector<std::string>{})) {
+        std::error_code ec;
+        if (path == source || fs::equivalent(path, source, ec)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string level_object(const std::string& object, const std::string& level) {
+    return sibling(object, "." + level + ".o");
+}
+
+MultiarchObjects multiarch_objects(const std::string& object, const std::vector<std::string>& levels) {
+    MultiarchObjects objects;
+    objects.first = {sibling(object, ".dispatch.o"), sibling(object, ".baseline.o")};
+    for (const auto& level : levels) {
+        objects.last.push_back(sibling(object, "." + level + ".mv.o"));
+    }
+    return objects;
+}
+
+int build_multiarch(const std::string& object, const std::vector<std::string>& levels, const std::string& compiler) {
+    std::string dispatch = sibling(object, ".dispatch.o");
+    std::vector<std::string> inputs = {object};
+    std::string signature = compiler + " multiarch";
+    for (const char* section : initializer_sections) {
+        signature += std::string(" -") + section;
+    }
+    for (const auto& level : levels) {
+        inputs.push_back(level_object(object, level));
+        signature += " " + level;
+    }
+    if (output_up_to_date(dispatch, dispatch, signature, inputs)) {
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << "🧬 Multiarch: " << object << "\n";
+    }
+
+    // The baseline keeps its data; level builds only refer to it, so their
+    // copies are weakened and lose to it at link time
+    Symbols baseline;
+    if (!defined_symbols(object, baseline)) {
+        return 1;
+    }
+    // Code refers to its own statics by section offset, so level builds
+    // cannot be pointed at the baseline's, and without their initializers
+    // they would use them unconstructed
+    bool initializers = false;
+    if (!has_initializers(object, initializers)) {
+        return 1;
+    }
+    if (initializers && !baseline.statics.empty()) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << "❌ Multiarch: " << object << " has static variables and runs code when the program "
+                  << "loads; give variables with constructors external linkage (no static, no anonymous "
+                  << "namespace) or move them out of the multiarch source\n";
+        return 1;
+    }
+    const std::set<std::string>& functions = baseline.functions;
+    MultiarchObjects objects = multiarch_objects(object, levels);
+    if (rewrite_object(object, objects.first[1], functions, "baseline", {}, false) != 0) {
+        return 1;
+    }
+    std::vector<std::set<std::string>> level_functions;
+    for (size_t n = 0; n < levels.size(); ++n) {
+        Symbols own;
+        if (!defined_symbols(inputs[n + 1], own)) {
+            return 1;
+        }
+        // Functions the baseline lacks cannot be dispatched to
+        std::set<std::string> renamed;
+        std::vector<std::string> weak = own.data;
+        for (const auto& function : own.functions) {
+            if (functions.count(function)) {
+                renamed.insert(function);
+            } else {
+                weak.push_back(function);
+            }
+        }
+        if (rewrite_object(inputs[n + 1], objects.last[n], renamed, level_tag(levels[n]), weak, true) != 0) {
+            return 1;
+        }
+        level_functions.push_back(renamed);
+    }
+
+    // Highest level first; a function without a build for a level uses the baseline
+    std::vector<size_t> order(levels.size());
+    for (size_t n = 0; n < order.size(); ++n) order[n] = n;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return levels[a] > levels[b]; });
+    std::string source = "// Generated by jmakepp for " + object + ": binds each function to the\n"
+        "// build for the CPU the program runs on when it loads\n"
+        "extern \"C\" {\n"
+        "static int jmakepp_level() {\n"
+        "    __builtin_cpu_init();\n";
+    for (size_t n : order) {
+        source += "    if (__builtin_cpu_supports(\"" + levels[n] + "\")) return " + std::to_string(n + 1) + ";\n";
+    }
+    source += "    return 0;\n}\n";
+    size_t index = 0;
+    for (const auto& function : functions) {
+        std::string id = std::to_string(index++);
+        std::string table;
+        source += "extern char jmakepp_" + id + "_0[] __asm__(\"" + function + ".baseline\");\n";
+        table += "jmakepp_" + id + "_0";
+        for (size_t n = 0; n < levels.size(); ++n) {
+            std::string impl = "jmakepp_" + id + "_" + std::to_string(n + 1);
+            if (level_functions[n].count(function)) {
+                source += "extern char " + impl + "[] __asm__(\"" + function + "." + level_tag(levels[n]) + "\");\n";
+                table += ", " + impl;
+            } else {
+                table += ", jmakepp_" + id + "_0";
+            }
+        }
+        source += "static void* jmakepp_resolve_" + id + "() {\n"
+            "    void* builds[] = {" + table + "};\n"
+            "    return builds[jmakepp_level()];\n}\n"
+            "void jmakepp_" + id + "() __asm__(\"" + function + "\") __attribute__((ifunc(\"jmakepp_resolve_" + id + "\")));\n";
+    }
+    source += "}\n";
+    std::string dispatch_source = sibling(object, ".dispatch.cpp");
+    filio::write(dispatch_source, source);
+    if (run_cmd(command_line(compiler, {"-c", "-fPIC", "-o", dispatch, dispatch_source}, "")) != 0) {
+        return 1;
+    }
+    write_signature(dispatch, signature);
+    invalidate_file(dispatch);
+    invalidate_file(dispatch + ".cmd");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "../include/dauser/pch.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/deps.hpp"
+#include "../include/dauser/depscan.hpp"
+#include "../include/dauser/filecache.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> hot_headers(const std::vector<CompileUnit>& units,
+    const std::vector<std::string>& includes,
+    double threshold,
+    const std::string& pch_header
+) {
+    IncludeScanner scanner(includes);
+    std::vector<std::string> pch_deps = pch_header.empty() ? std::vector<std::string>{} : read_depfile(pch_header + ".d");
+    const std::set<std::string> source_exts = {".c", ".cc", ".cpp", ".cxx", ".c++", ".cppm", ".ixx", ".mpp", ".mxx"};
+
+    std::map<std::string, int> counts;
+    size_t scanned = 0;
+    for (const auto& unit : units) {
+        std::vector<std::string> deps = read_depfile(fs::path(unit.object).replace_extension(".d").string());
+        if (deps.empty()) {
+            deps = scanner.dependencies(unit.source);
+        } else if (!pch_deps.empty()) {
+            std::string signature;
+            if (read_file_cached(unit.object + ".cmd", signature) &&
+                signature.find(" -include " + pch_header + " ") != std::string::npos) {
+                deps.insert(deps.end(), pch_deps.begin(), pch_deps.end());
+            }
+        }
+        ++scanned;
+        std::set<std::string> seen;
+        for (const auto& dep : deps) {
+            std::string path = fs::weakly_canonical(dep).string();
+            std::string ext = fs::path(path).extension().string();
+            // Sources pulled in by unity files and earlier PCH inputs are not candidates
+            if (source_exts.count(ext) || ext == ".gch" || fs::path(path).filename() == "pch.hpp" || fs::path(path).filename() == "pch.h") {
+                continue;
+            }
+            if (seen.insert(path).second) {
+                counts[path]++;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, int>> ranked(counts.begin(), counts.end());
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second;
+    });
+
+    std::vector<std::string> headers;
+    for (const auto& entry : ranked) {
+        if (scanned > 0 && entry.second >= threshold * scanned) {
+            headers.push_back(entry.first);
+        }
+    }
+    return headers;
+}
+
+std::string prepare_pch(const std::string& pch,
+    const std::vector<CompileUnit>& units,
+    const std::string& compiler,
+    const std::vector<std::string>& flags,
+    const std::vector<std::string>& includes,
+    const std::string& build_dir,
+    bool c,
+    double threshold
+) {
+    std::string pch_dir = build_dir + "pch/";
+    fs::create_directories(pch_dir);
+    std::string header = fs::absolute(pch_dir + (c ? "pch.h" : "pch.hpp")).string();
+
+    std::string contents = "// Generated by jmakepp, do not edit\n";
+    if (pch == "auto") {
+        std::vector<std::string> headers = hot_headers(units, includes, threshold, header);
+        if (headers.empty()) {
+            std::cout << "⚠️ PCH: no frequently included headers found, building without PCH\n";
+            return "";
+        }
+        std::cout << "📌 PCH: selected " << headers.size() << " header(s) from include frequency\n";
+        for (const auto& h : headers) {
+            contents += "#include \"" + fs::path(h).generic_string() + "\"\n";
+        }
+    } else {
+        if (!fs::exists(pch)) {
+            std::cerr << "⚠️ PCH header '" << pch << "' not found, building without PCH\n";
+            return "";
+        }
+        contents += "#include \"" + fs::absolute(pch).generic_string() + "\"\n";
+    }
+
+    // Only touch the header when its contents change so the .gch stays valid
+    std::stringstream current;
+    {
+        std::ifstream existing(header);
+        current << existing.rdbuf();
+    }
+    if (current.str() != contents) {
+        std::ofstream out(header, std::ios::trunc);
+        out << contents;
+    }
+
+    std::string gch = header + ".gch";
+    std::string depfile = header + ".d";
+    std::string signature = compiler + " -x " + (c ? "c-header" : "c++-header");
+    for (const auto& flag : flags) {
+        signature += " " + flag;
+    }
+    for (const auto& inc : includes) {
+        signature += " " + inc;
+    }
+    sync_file_cache();
+    if (object_up_to_date(gch, signature)) {
+        return header;
+    }
+
+    std::vector<std::string> args = {"-x", c ? "c-header" : "c++-header", "-fPIC", "-MMD", "-MF", depfile,
+        "-o", gch, header};
+    args.insert(args.end(), flags.begin(), flags.end());
+    args.insert(args.end(), includes.begin(), includes.end());
+    std::string command = command_line(compiler, args, pch_dir + "rsp");
+
+    std::cout << "📌 Precompiling header: " << header << "\n";
+    if (run_cmd(command) != 0) {
+        std::cerr << "⚠️ PCH build failed, building without PCH\n";
+        fs::remove(gch);
+        return "";
+    }
+    write_signature(gch, signature);
+    return header;
+}
+
+std::vector<std::string> pch_flags(const std::string& pch_header) {
+    return {"-include", pch_header, "-Winvalid-pch"};
+}
+
+void use_pch(CompileUnit& unit, const std::string& pch_header) {
+    std::vector<std::string> extra = pch_flags(pch_header);
+    unit.flags.insert(unit.flags.end(), extra.begin(), extra.end());
+    unit.deps.push_back(pch_header + ".gch");
+}
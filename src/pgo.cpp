@@ -0,0 +1,192 @@
+#include "../include/dauser/pgo.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/buildlock.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/deps.hpp"
+#include "../include/dauser/filecache.hpp"
+#include "../include/dauser/filio.hpp"
+#include "../include/dauser/linker.hpp"
+#include "../include/dauser/platform.hpp"
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+static std::string absolute_dir(const std::string& dir) {
+    return fs::absolute(dir).lexically_normal().string();
+}
+
+// clang merges its raw profiles into this one file
+static const char* merged_profile = "default.profdata";
+
+std::vector<std::string> profile_flags(const json& settings, const std::string& variant,
+    const std::string& compiler, const std::string& buildpath
+) {
+    std::string generate = variant_value(settings, variant, "profile generate", "").get<std::string>();
+    std::string use = variant_value(settings, variant, "profile use", "").get<std::string>();
+    if (generate.empty() && use.empty()) {
+        return {};
+    }
+    if (is_clang(compiler)) {
+        if (!generate.empty()) {
+            return {"-fprofile-generate=" + absolute_dir(generate)};
+        }
+        return {"-fprofile-use=" + absolute_dir(use) + "/" + merged_profile};
+    }
+    // g++ names each profile after its object, minus the prefix path. It
+    // compares the paths as written, so the prefix must not be normalized.
+    std::string prefix = "-fprofile-prefix-path=" + fs::absolute(buildpath).string();
+    if (!generate.empty()) {
+        return {"-fprofile-generate=" + absolute_dir(generate), "-fprofile-update=prefer-atomic", prefix};
+    }
+    return {"-fprofile-use=" + absolute_dir(use), prefix, "-Wno-missing-profile"};
+}
+
+std::string profile_dependency(const json& settings, const std::string& variant,
+    const std::string& compiler, const std::string& buildpath, const std::string& object
+) {
+    std::string use = variant_value(settings, variant, "profile use", "").get<std::string>();
+    if (use.empty()) {
+        return "";
+    }
+    std::string profile;
+    if (is_clang(compiler)) {
+        profile = (fs::path(use) / merged_profile).string();
+    } else {
+        std::string name = fs::path(object).lexically_normal().lexically_relative(
+            fs::path(buildpath).lexically_normal()).replace_extension(".gcda").generic_string();
+        for (char& ch : name) {
+            if (ch == '/') ch = '#';
+        }
+        profile = (fs::path(use) / name).string();
+    }
+    fs::file_time_type time;
+    return file_mtime(profile, time) ? profile : "";
+}
+
+// Stage variants of jmakepp pgo: the variant base with a profile setting
+static json pgo_variant(const json& config, const std::string& base, const std::string& key, const std::string& dir) {
+    json stage = json::object();
+    if (!base.empty() && config.contains("variants") && config["variants"].contains(base)) {
+        stage = config["variants"][base];
+    }
+    stage.erase("profile generate");
+    stage.erase("profile use");
+    stage[key] = dir;
+    return stage;
+}
+
+// Build target for the host in one variant. outputs receives every file the build links.
+static bool build_stage(const json& config, const std::string& target, const std::string& variant,
+    std::vector<std::string>& outputs
+) {
+    BuildOptions options;
+    options.platform = host_platform();
+    options.variant = variant;
+    options.target = target;
+    return build_config(config, options, outputs);
+}
+
+// Copy file into dir unless an identical copy is there, so objects
+// optimized with an unchanged profile are not recompiled. Returns true if
+// the copy in dir changed.
+static bool replace_if_changed(const fs::path& file, const fs::path& dir) {
+    fs::path target = dir / file.filename();
+    if (fs::exists(target) && filio::bin_read(target) == filio::bin_read(file)) {
+        return false;
+    }
+    fs::copy_file(file, target, fs::copy_options::overwrite_existing);
+    invalidate_file(target.string());
+    return true;
+}
+
+// Turn the raw profile of a training run into the profile the optimized
+// build reads: the .gcda files as they are for g++, one merged file for clang
+static bool merge_profile(const std::string& compiler, const std::string& raw_dir, const std::string& profile_dir) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(raw_dir, ec)) {
+        std::string ext = entry.path().extension().string();
+        if (ext == ".gcda" || ext == ".profraw") files.push_back(entry.path());
+    }
+    if (files.empty()) {
+        std::cout << "❌ The training run wrote no profile to " << raw_dir << "\n";
+        return false;
+    }
+    fs::create_directories(profile_dir);
+
+    size_t changed = 0;
+    if (is_clang(compiler)) {
+        std::string merged = raw_dir + merged_profile;
+        std::vector<std::string> args = {"merge", "-o", merged};
+        for (const auto& file : files) {
+            args.push_back(file.string());
+        }
+        if (run_cmd(command_line("llvm-profdata", args, raw_dir + "rsp")) != 0) {
+            return false;
+        }
+        changed += replace_if_changed(merged, profile_dir);
+    } else {
+        for (const auto& file : files) {
+            changed += replace_if_changed(file, profile_dir);
+        }
+    }
+    std::cout << "📈 Profile: " << changed << " of " << files.size() << " file(s) changed\n";
+    return true;
+}
+
+bool run_pgo(const std::string& requested_target, const std::string& requested_variant,
+    const std::vector<std::string>& args
+) {
+    json config = load_project_config();
+    std::string base = selected_variant(config, requested_variant);
+    std::string target = run_target(config, requested_target);
+    std::string instrument = (base.empty() ? "" : base + "-") + "pgo-instrument";
+    std::string optimize = (base.empty() ? "" : base + "-") + "pgo";
+    std::string raw_dir = variant_buildpath(config, instrument) + "profile-raw/";
+    std::string profile_dir = variant_buildpath(config, optimize) + "profile/";
+
+    add_variant(config, instrument, pgo_variant(config, base, "profile generate", raw_dir));
+    add_variant(config, optimize, pgo_variant(config, base, "profile use", profile_dir));
+    // Another pgo run, or a build of these variants, waits until this one is done
+    BuildLocks locks({variant_buildpath(config, instrument), variant_buildpath(config, optimize)});
+
+    std::cout << "🧪 PGO: instrumenting\n";
+    std::vector<std::string> instrumented;
+    if (!build_stage(config, target, instrument, instrumented)) {
+        return false;
+    }
+
+    // Training is repeated only when an instrumented output or the run changed
+    std::string platform = host_platform();
+    std::string binary = output_path(target_config(config, target), platform, config["version"], instrument);
+    std::vector<std::string> train = args.empty() ? config_arguments(config, "pgo train") : args;
+    std::string command = command_line(binary, train, "");
+    std::string stamp = profile_dir + "trained";
+    if (output_up_to_date(stamp + ".cmd", stamp, command, instrumented)) {
+        std::cout << "⏭️ PGO: profile up to date\n";
+    } else {
+        std::cout << "🏋️ PGO: training: " << command << "\n";
+        std::error_code ec;
+        fs::remove_all(raw_dir, ec);
+        int code = run_program(binary, train);
+        if (code != 0) {
+            std::cout << "❌ Training run failed with code " << code << "\n";
+            return false;
+        }
+        if (!merge_profile(platform_compiler(platform, config["c"]), raw_dir, profile_dir)) {
+            return false;
+        }
+        write_signature(stamp, command);
+        invalidate_file(stamp + ".cmd");
+    }
+
+    std::cout << "🚀 PGO: optimizing\n";
+    std::vector<std::string> optimized;
+    if (!build_stage(config, target, optimize, optimized)) {
+        return false;
+    }
+    std::cout << "✅ Profile-guided build -> "
+              << output_path(target_config(config, target), platform, config["version"], optimize) << "\n";
+    return true;
+}
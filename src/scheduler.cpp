@@ -0,0 +1,111 @@
+#include "../include/dauser/scheduler.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+const size_t JobGraph::none;
+
+size_t JobGraph::add(std::function<int()> job, const std::vector<size_t>& after, int weight) {
+    jobs.push_back(job);
+    prerequisites.push_back(after);
+    weights.push_back(weight < 1 ? 1 : weight);
+    return jobs.size() - 1;
+}
+
+size_t JobGraph::size() const {
+    return jobs.size();
+}
+
+std::vector<int> JobGraph::run(int max_threads) {
+    size_t count = jobs.size();
+    std::vector<int> results(count, 0);
+    if (count == 0) {
+        return results;
+    }
+    if (max_threads < 1) max_threads = 1;
+
+    std::vector<size_t> waiting(count, 0);
+    std::vector<bool> blocked(count, false);
+    std::vector<std::vector<size_t>> dependents(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t before : prerequisites[i]) {
+            if (before == none || before >= count) continue;
+            dependents[before].push_back(i);
+            ++waiting[i];
+        }
+    }
+
+    // Lower ids first keeps the order jobs were added in when there is a choice
+    std::set<size_t> ready;
+    for (size_t i = 0; i < count; ++i) {
+        if (waiting[i] == 0) ready.insert(i);
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    size_t running = 0;
+    int used = 0; // threads taken by running jobs, counting their weights
+
+    // Oldest ready job if it fits in the threads left, or none. A heavy job
+    // that does not fit yet holds back the jobs after it, so that lighter
+    // ones cannot keep taking the threads it waits for. Caller holds mutex.
+    auto next_job = [&]() {
+        if (ready.empty()) return none;
+        size_t id = *ready.begin();
+        return used + std::min(weights[id], max_threads) <= max_threads ? id : none;
+    };
+
+    // Record a finished job and release the jobs waiting on it. Jobs that
+    // can no longer run finish right away. Caller holds mutex.
+    std::function<void(size_t, int)> finish = [&](size_t id, int result) {
+        results[id] = result;
+        for (size_t next : dependents[id]) {
+            if (result != 0) blocked[next] = true;
+            if (--waiting[next] > 0) continue;
+            if (blocked[next]) {
+                finish(next, 1);
+            } else {
+                ready.insert(next);
+            }
+        }
+    };
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&]() { return next_job() != none || running == 0; });
+            size_t id = next_job();
+            if (id == none) {
+                return;
+            }
+            int weight = std::min(weights[id], max_threads);
+            ready.erase(id);
+            ++running;
+            used += weight;
+            lock.unlock();
+            int result = jobs[id]();
+            lock.lock();
+            --running;
+            used -= weight;
+            finish(id, result);
+            wake.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    size_t thread_count = std::min<size_t>(count, max_threads);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Jobs left waiting are part of a cycle
+    for (size_t i = 0; i < count; ++i) {
+        if (waiting[i] > 0) results[i] = 1;
+    }
+    return results;
+}
@@ -0,0 +1,276 @@
+#include "../include/dauser/size.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/filecache.hpp"
+#include "../include/dauser/filio.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Symbols kept per report, largest first
+    const size_t symbol_count = 200;
+    // Rows printed per table
+    const size_t shown_rows = 15;
+
+    // binutils for a platform's outputs
+    std::string binutil(const std::string& platform, const std::string& tool) {
+        return platform == "windows" ? "x86_64-w64-mingw32-" + tool : tool;
+    }
+
+    // Report of an output. Variants share file names, and with "override
+    // binary name" so do versions, so both are marked.
+    std::string report_path(const std::string& dir, const std::string& output, const std::string& version,
+        const std::string& variant
+    ) {
+        std::string name = fs::path(output).filename().string() + (variant.empty() ? "" : "." + variant);
+        return (fs::path(dir) / (name + "@" + version + ".json")).string();
+    }
+
+    // A size printed by size or nm; false for anything else, such as a
+    // header or a symbol without one
+    bool parse_size(const std::string& text, int base, long long& value) {
+        try {
+            size_t end = 0;
+            value = std::stoll(text, &end, base);
+            return end == text.size();
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    void warn(const std::string& message) {
+        std::lock_guard<std::mutex> lock(compilation_mutex);
+        std::cerr << "⚠️ " << message << "\n";
+    }
+
+    std::string signed_bytes(long long value) {
+        return (value > 0 ? "+" : "") + std::to_string(value);
+    }
+
+    // Entries of a name -> size object, largest first
+    std::vector<std::pair<std::string, long long>> largest(const json& sizes) {
+        std::vector<std::pair<std::string, long long>> rows;
+        for (const auto& entry : sizes.items()) {
+            rows.push_back({entry.key(), entry.value().get<long long>()});
+        }
+        std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        return rows;
+    }
+
+    // Symbol sizes of a report as a name -> size object
+    json symbol_sizes(const json& report) {
+        json sizes = json::object();
+        for (const auto& symbol : report["symbols"]) {
+            sizes[symbol["name"].get<std::string>()] = symbol["size"];
+        }
+        return sizes;
+    }
+
+    void print_largest(const std::string& title, const json& sizes) {
+        std::cout << "   " << title << ":\n";
+        std::vector<std::pair<std::string, long long>> rows = largest(sizes);
+        for (size_t n = 0; n < rows.size() && n < shown_rows; ++n) {
+            std::cout << "      " << rows[n].second << "  " << rows[n].first << "\n";
+        }
+    }
+
+    // Changes between two name -> size objects, largest change first
+    void print_changes(const std::string& title, const json& before, const json& after) {
+        std::map<std::string, long long> delta;
+        for (const auto& entry : before.items()) delta[entry.key()] -= entry.value().get<long long>();
+        for (const auto& entry : after.items()) delta[entry.key()] += entry.value().get<long long>();
+        std::vector<std::pair<std::string, long long>> rows;
+        for (const auto& entry : delta) {
+            if (entry.second != 0) rows.push_back(entry);
+        }
+        std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+            return std::llabs(a.second) > std::llabs(b.second);
+        });
+        std::cout << "   " << title << (rows.empty() ? ": unchanged\n" : ":\n");
+        for (size_t n = 0; n < rows.size() && n < shown_rows; ++n) {
+            std::string note = !before.contains(rows[n].first) ? " (new)" : !after.contains(rows[n].first) ? " (gone)" : "";
+            std::cout << "      " << signed_bytes(rows[n].second) << "  " << rows[n].first << note << "\n";
+        }
+    }
+}
+
+std::string size_report_dir(const json& settings) {
+    json setting = settings.value("size report", json(false));
+    if (setting.is_boolean()) {
+        return setting.get<bool>() ? "./sizes/" : "";
+    }
+    return setting.get<std::string>();
+}
+
+bool record_size_report(const std::string& output, const std::vector<std::string>& objects,
+    const std::string& platform, const std::string& dir, const json& info
+) {
+    std::string path = report_path(dir, output, info.value("version", ""), info.value("variant", ""));
+    fs::file_time_type report_time, output_time;
+    if (file_mtime(path, report_time) && file_mtime(output, output_time) && report_time > output_time) {
+        return true;
+    }
+
+    std::error_code ec;
+    auto file_size = fs::file_size(output, ec);
+    if (ec) {
+        warn("Could not read the size of " + output + ": " + ec.message());
+        return false;
+    }
+    fs::create_directories(dir, ec);
+    if (ec) {
+        warn("Could not create " + dir + ": " + ec.message());
+        return false;
+    }
+    json report = info;
+    report["output"] = output;
+    report["file size"] = file_size;
+
+    // size -A: one "name size address" line per section
+    std::string text;
+    if (capture_cmd(binutil(platform, "size") + " -A \"" + output + "\"", text) != 0) {
+        warn("Could not read the sections of " + output);
+        return false;
+    }
+    report["sections"] = json::object();
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string name, size;
+        long long bytes;
+        if (!(fields >> name >> size) || name[0] != '.') continue;
+        if (parse_size(size, 10, bytes)) {
+            report["sections"][name] = bytes;
+        }
+    }
+
+    // nm --size-sort lists the largest symbols last
+    report["symbols"] = json::array();
+    if (capture_cmd(binutil(platform, "nm") + " -S --size-sort -C \"" + output + "\"", text) == 0) {
+        std::vector<json> symbols;
+        std::istringstream symbol_lines(text);
+        while (std::getline(symbol_lines, line)) {
+            std::istringstream fields(line);
+            std::string address, size, type;
+            long long bytes;
+            if (!(fields >> address >> size >> type) || !parse_size(size, 16, bytes)) continue;
+            std::string name;
+            std::getline(fields >> std::ws, name);
+            symbols.push_back({{"name", name}, {"size", bytes}, {"type", type}});
+        }
+        for (size_t n = 0; n < symbols.size() && n < symbol_count; ++n) {
+            report["symbols"].push_back(symbols[symbols.size() - 1 - n]);
+        }
+    }
+
+    // Berkeley totals (text + data + bss) of each input object or archive member
+    report["objects"] = json::object();
+    if (!objects.empty()) {
+        std::string command;
+        try {
+            command = command_line(binutil(platform, "size"), objects, (fs::path(dir) / "rsp").string());
+        } catch (const std::exception& e) {
+            warn(std::string("Could not read the sizes of the objects: ") + e.what());
+        }
+        if (!command.empty() && capture_cmd(command, text) == 0) {
+            std::istringstream object_lines(text);
+            std::getline(object_lines, line); // header
+            while (std::getline(object_lines, line)) {
+                std::istringstream fields(line);
+                std::string text_size, data, bss, dec, hex, name;
+                long long bytes;
+                if (!(fields >> text_size >> data >> bss >> dec >> hex) || !parse_size(dec, 10, bytes)) continue;
+                std::getline(fields >> std::ws, name);
+                report["objects"][name] = bytes;
+            }
+        }
+    }
+
+    try {
+        filio::write(path, report.dump(4));
+    } catch (const std::exception& e) {
+        warn(std::string("Could not write the size report: ") + e.what());
+        return false;
+    }
+    invalidate_file(path);
+    return true;
+}
+
+bool show_size(const std::string& version, const std::string& other_version, const std::string& requested_target,
+    const std::string& platform, const std::string& requested_variant
+) {
+    json config = load_project_config();
+    std::string variant = selected_variant(config, requested_variant);
+    std::string from = version.empty() ? config["version"].get<std::string>() : version;
+    std::vector<std::string> targets = requested_target.empty() ? project_targets(config) : std::vector<std::string>{requested_target};
+
+    bool found = true;
+    for (const auto& target : targets) {
+        json settings = target_config(config, target);
+        std::string dir = size_report_dir(settings);
+        if (settings["type"] == "static") continue;
+        if (dir.empty()) {
+            std::cout << "⚠️ " << (target.empty() ? "The project" : target) << " has no \"size report\" in project.json\n";
+            found = false;
+            continue;
+        }
+        auto load = [&](const std::string& wanted, json& report) {
+            std::string path = report_path(dir, output_path(settings, platform, wanted, variant), wanted, variant);
+            if (!fs::exists(path)) {
+                std::cout << "❌ No size report for version " << wanted << " (" << path << ")\n";
+                return false;
+            }
+            report = json::parse(filio::read(path));
+            if (report.value("version", "") != wanted) {
+                std::cout << "❌ " << path << " is the size report of version " << report.value("version", "?")
+                          << ", not " << wanted << "\n";
+                return false;
+            }
+            return true;
+        };
+        std::string name = target.empty() ? settings["name"].get<std::string>() : target;
+
+        json before;
+        if (!load(from, before)) {
+            found = false;
+            continue;
+        }
+        if (other_version.empty()) {
+            std::cout << "📏 " << name << " " << from << " (" << platform << "): "
+                      << before["file size"].get<long long>() << " bytes\n";
+            print_largest("sections", before["sections"]);
+            print_largest("objects", before["objects"]);
+            print_largest("symbols", symbol_sizes(before));
+            continue;
+        }
+
+        json after;
+        if (!load(other_version, after)) {
+            found = false;
+            continue;
+        }
+        long long old_size = before["file size"], new_size = after["file size"];
+        std::cout << "📏 " << name << " " << from << " -> " << other_version << " (" << platform << "): "
+                  << old_size << " -> " << new_size << " bytes (" << signed_bytes(new_size - old_size);
+        if (old_size > 0) {
+            char percent[32];
+            std::snprintf(percent, sizeof(percent), "%+.1f%%", 100.0 * (new_size - old_size) / old_size);
+            std::cout << ", " << percent;
+        }
+        std::cout << ")\n";
+        print_changes("sections", before["sections"], after["sections"]);
+        print_changes("objects", before["objects"], after["objects"]);
+        print_changes("symbols", symbol_sizes(before), symbol_sizes(after));
+    }
+    return found;
+}
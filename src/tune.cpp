@@ -0,0 +1,141 @@
+#include "../include/dauser/tune.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/config.hpp"
+#include "../include/dauser/platform.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Flag sets tried when project.json lists none
+    json default_candidates() {
+        return {
+            {"O2", {{"flags", "-O2"}}},
+            {"O3", {{"flags", "-O3"}}},
+            {"O3-native", {{"flags", "-O3 -march=native"}}},
+            {"O3-lto", {{"flags", "-O3"}, {"lto", "full"}}},
+            {"O2-noplt", {{"flags", "-O2 -fno-plt"}}}
+        };
+    }
+
+    // Two-sided 95% quantile of Student's t distribution
+    double t_quantile(size_t degrees) {
+        static const double table[] = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+        };
+        return degrees >= 1 && degrees <= 30 ? table[degrees - 1] : 1.960;
+    }
+
+    struct Measurement {
+        std::string name;
+        double mean;
+        double margin; // half width of the 95% confidence interval
+    };
+
+    std::string seconds(double value) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.4f s", value);
+        return text;
+    }
+
+    // Time runs of binary after a warm-up run. Returns false if a run failed.
+    bool measure(const std::string& binary, const std::vector<std::string>& args, int runs, Measurement& result) {
+        if (run_program(binary, args) != 0) {
+            return false;
+        }
+        std::vector<double> times;
+        for (int n = 0; n < runs; ++n) {
+            auto start = std::chrono::steady_clock::now();
+            int code = run_program(binary, args);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (code != 0) {
+                return false;
+            }
+            times.push_back(elapsed.count());
+        }
+        double sum = 0;
+        for (double time : times) sum += time;
+        result.mean = sum / times.size();
+        double squares = 0;
+        for (double time : times) squares += (time - result.mean) * (time - result.mean);
+        double deviation = std::sqrt(squares / (times.size() - 1));
+        result.margin = t_quantile(times.size() - 1) * deviation / std::sqrt(static_cast<double>(times.size()));
+        return true;
+    }
+}
+
+bool run_tune(const std::string& requested_target, int runs, bool write, const std::vector<std::string>& args) {
+    json config = load_project_config();
+    std::string target = run_target(config, requested_target);
+    json candidates = config.value("tune candidates", default_candidates());
+    std::vector<std::string> benchmark = args.empty() ? config_arguments(config, "tune benchmark") : args;
+    if (runs == 0) runs = config.value("tune runs", 5);
+    if (runs < 2) runs = 2;
+
+    // Each candidate is a variant, so its objects survive until the next tune
+    for (const auto& candidate : candidates.items()) {
+        add_variant(config, "tune-" + candidate.key(), candidate.value());
+    }
+    std::cout << "⏱️ Tuning " << candidates.size() << " candidate(s), " << runs << " run(s) each\n";
+
+    std::string platform = host_platform();
+    std::vector<Measurement> results;
+    for (const auto& candidate : candidates.items()) {
+        std::string variant = "tune-" + candidate.key();
+        BuildOptions options;
+        options.platform = platform;
+        options.variant = variant;
+        options.target = target;
+        std::vector<std::string> outputs;
+        if (!build_config(config, options, outputs)) {
+            std::cout << "❌ " << candidate.key() << ": build failed, skipping\n";
+            continue;
+        }
+        std::string binary = output_path(target_config(config, target), platform, config["version"], variant);
+        Measurement result{candidate.key(), 0, 0};
+        if (!measure(binary, benchmark, runs, result)) {
+            std::cout << "❌ " << candidate.key() << ": benchmark failed, skipping\n";
+            continue;
+        }
+        std::cout << "🏁 " << result.name << ": " << seconds(result.mean) << " ± " << seconds(result.margin) << "\n";
+        results.push_back(result);
+    }
+    if (results.empty()) {
+        std::cout << "❌ No candidate could be measured\n";
+        return false;
+    }
+
+    std::sort(results.begin(), results.end(), [](const Measurement& a, const Measurement& b) { return a.mean < b.mean; });
+    std::cout << "\n📊 Mean time with 95% confidence interval:\n";
+    for (const auto& result : results) {
+        std::cout << "   " << result.name << ": " << seconds(result.mean) << " ± " << seconds(result.margin) << "\n";
+    }
+    const Measurement& best = results[0];
+    std::cout << "🏆 Fastest: " << best.name;
+    if (results.size() > 1) {
+        const Measurement& next = results[1];
+        std::cout << ", " << std::round(1000 * (1 - best.mean / next.mean)) / 10 << "% faster than " << next.name << "\n";
+        if (best.mean + best.margin >= next.mean - next.margin) {
+            std::cout << "⚠️ The intervals of " << best.name << " and " << next.name
+                      << " overlap, more runs (--runs) may change the order\n";
+        }
+    } else {
+        std::cout << "\n";
+    }
+
+    if (write) {
+        json project = load_project_config();
+        add_variant(project, "tuned", candidates[best.name]);
+        project["variant"] = "tuned";
+        std::ofstream out("project.json");
+        out << project.dump(4);
+        std::cout << "💾 Saved " << best.name << " as the default variant \"tuned\"\n";
+    }
+    return true;
+}
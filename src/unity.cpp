@@ -0,0 +1,500 @@
+#include "../include/dauser/unity.hpp"
+#include "../include/dauser/deps.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Split source text into identifiers and single punctuation characters,
+// dropping comments and string/char literals. Preprocessor lines go to
+// directives instead, with their continuations joined.
+static std::vector<std::string> tokenize(const std::string& text, std::vector<std::string>& directives) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    bool line_start = true;
+    while (i < text.size()) {
+        char ch = text[i];
+        if (ch == '\n') {
+            line_start = true;
+            ++i;
+            continue;
+        }
+        if (ch == ' ' || ch == '\t' || ch == '\r') {
+            ++i;
+            continue;
+        }
+        if (line_start && ch == '#') {
+            std::string directive;
+            while (i < text.size() && text[i] != '\n') {
+                if (text[i] == '\\' && i + 1 < text.size() && (text[i + 1] == '\n' || text[i + 1] == '\r')) {
+                    i += text[i + 1] == '\r' && i + 2 < text.size() && text[i + 2] == '\n' ? 3 : 2;
+                    directive += ' ';
+                    continue;
+                }
+                directive += text[i];
+                ++i;
+            }
+            directives.push_back(directive);
+            continue;
+        }
+        line_start = false;
+        if (ch == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+            while (i < text.size() && text[i] != '\n') ++i;
+            continue;
+        }
+        if (ch == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+            size_t end = text.find("*/", i + 2);
+            i = (end == std::string::npos) ? text.size() : end + 2;
+            continue;
+        }
+        if (ch == 'R' && i + 1 < text.size() && text[i + 1] == '"') {
+            size_t open = text.find('(', i + 2);
+            if (open != std::string::npos) {
+                std::string close = ")" + text.substr(i + 2, open - i - 2) + "\"";
+                size_t end = text.find(close, open);
+                i = (end == std::string::npos) ? text.size() : end + close.size();
+                continue;
+            }
+        }
+        if (ch == '"' || ch == '\'') {
+            ++i;
+            while (i < text.size() && text[i] != ch) {
+                if (text[i] == '\\') ++i;
+                ++i;
+            }
+            ++i;
+            continue;
+        }
+        if (std::isalnum(static_cast<unsigned char>(ch)) || ch == '_') {
+            size_t start = i;
+            while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_')) ++i;
+            tokens.push_back(text.substr(start, i - start));
+            continue;
+        }
+        if (ch == ':' && i + 1 < text.size() && text[i + 1] == ':') {
+            tokens.push_back("::");
+            i += 2;
+            continue;
+        }
+        tokens.push_back(std::string(1, ch));
+        ++i;
+    }
+    return tokens;
+}
+
+static bool is_identifier(const std::string& token) {
+    return !token.empty() && (std::isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_');
+}
+
+// Macros a source defines and still has defined at its end, and every
+// identifier its directives mention
+static void scan_directives(const std::vector<std::string>& directives, SourceNames& names) {
+    for (const auto& directive : directives) {
+        std::vector<std::string> ignored;
+        std::vector<std::string> words = tokenize(directive.substr(1), ignored);
+        if (words.empty()) continue;
+        if (words[0] == "define" && words.size() > 1) {
+            names.macros.insert(words[1]);
+            words.erase(words.begin() + 1);
+        } else if (words[0] == "undef" && words.size() > 1) {
+            names.macros.erase(words[1]);
+        } else if (words[0] == "include") {
+            continue;
+        }
+        for (size_t n = 1; n < words.size(); ++n) {
+            if (is_identifier(words[n])) names.identifiers.insert(words[n]);
+        }
+    }
+}
+
+SourceNames source_names(const std::string& source_file) {
+    std::ifstream file(source_file);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::vector<std::string> directives;
+    std::vector<std::string> tokens = tokenize(ss.str(), directives);
+
+    SourceNames names;
+    scan_directives(directives, names);
+    for (const auto& tok : tokens) {
+        if (is_identifier(tok)) names.identifiers.insert(tok);
+    }
+
+    // Each open brace is a named namespace, an anonymous namespace, a linkage
+    // specification or anything else
+    struct Scope { char kind; std::string name; };
+    std::vector<Scope> scopes;
+
+    // State of the declaration being read at namespace scope
+    bool is_static = false;
+    bool is_extern = false;
+    bool is_inline = false;
+    bool is_const = false;  // the declared object itself is const
+    std::string last_ident;
+    bool statement_done = false;
+    std::string type_name;  // name after class, struct, union or enum
+    bool is_enum = false;
+    bool scoped_enum = false;
+    bool in_bases = false;  // reading a base clause or enum base
+
+    auto at_namespace_scope = [&]() {
+        for (const auto& scope : scopes) {
+            if (scope.kind == 'O') return false;
+        }
+        return true;
+    };
+    auto in_anonymous = [&]() {
+        for (const auto& scope : scopes) {
+            if (scope.kind == 'A') return true;
+        }
+        return false;
+    };
+    auto qualified = [&](const std::string& name) {
+        std::string prefix;
+        for (const auto& scope : scopes) {
+            if (scope.kind == 'N') prefix += scope.name + "::";
+        }
+        return prefix + name;
+    };
+    // A namespace-scope const object has internal linkage, unless it is
+    // extern or inline; a function returning a const value does not
+    auto record = [&](bool function) {
+        if (!statement_done && !last_ident.empty()) {
+            // Class members defined out of line (Class::name) are never internal
+            bool member = last_ident.find("::") != std::string::npos;
+            bool internal = !member && (is_static || in_anonymous() || (!function && is_const && !is_extern && !is_inline));
+            (internal ? names.internal : names.external).insert(qualified(last_ident));
+        }
+        statement_done = true;
+    };
+    auto reset = [&]() {
+        is_static = is_extern = is_inline = is_const = false;
+        last_ident.clear();
+        statement_done = false;
+        type_name.clear();
+        is_enum = scoped_enum = in_bases = false;
+    };
+    // Text of tokens[from, to) joined by spaces
+    auto join = [&](size_t from, size_t to) {
+        std::string text;
+        for (size_t n = from; n < to && n < tokens.size(); ++n) {
+            text += (text.empty() ? "" : " ") + tokens[n];
+        }
+        return text;
+    };
+    auto statement_end = [&](size_t from) {
+        size_t end = from;
+        while (end < tokens.size() && tokens[end] != ";") ++end;
+        return end;
+    };
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const std::string& tok = tokens[i];
+        bool namespace_scope = at_namespace_scope();
+
+        if (tok == "namespace" && namespace_scope) {
+            // namespace [name[::name]] {  or a namespace alias
+            std::string name;
+            size_t j = i + 1;
+            while (j < tokens.size() && (is_identifier(tokens[j]) || tokens[j] == "::")) {
+                name += tokens[j];
+                ++j;
+            }
+            if (j < tokens.size() && tokens[j] == "{") {
+                scopes.push_back({name.empty() ? 'A' : 'N', name});
+                i = j;
+                reset();
+                continue;
+            }
+            if (j < tokens.size() && tokens[j] == "=") {
+                size_t end = statement_end(j);
+                names.aliases[qualified(name)] = join(j + 1, end);
+                i = end;
+                reset();
+                continue;
+            }
+        }
+
+        if (tok == "{") {
+            if (namespace_scope && i > 0 && tokens[i - 1] == "extern") {
+                // extern "C" { ... } keeps namespace scope
+                scopes.push_back({'L', ""});
+                reset();
+                continue;
+            }
+            if (namespace_scope) {
+                if (!type_name.empty() && (in_bases || last_ident == type_name)) {
+                    names.internal.insert(qualified(type_name));
+                    statement_done = true;
+                }
+                if (is_enum && !scoped_enum) {
+                    // Enumerators of an unscoped enum belong to the enclosing namespace
+                    int depth = 0;
+                    bool expect_name = true;
+                    for (size_t j = i + 1; j < tokens.size() && depth >= 0; ++j) {
+                        if (tokens[j] == "{" || tokens[j] == "(") ++depth;
+                        if (tokens[j] == "}" || tokens[j] == ")") --depth;
+                        if (depth != 0) continue;
+                        if (expect_name && is_identifier(tokens[j])) names.internal.insert(qualified(tokens[j]));
+                        expect_name = tokens[j] == ",";
+                    }
+                }
+                record(false);
+            }
+            scopes.push_back({'O', ""});
+            continue;
+        }
+        if (tok == "}") {
+            if (!scopes.empty()) {
+                scopes.pop_back();
+                // A function body or namespace just closed at namespace scope
+                if (at_namespace_scope()) reset();
+            }
+            continue;
+        }
+        if (!namespace_scope) {
+            continue;
+        }
+
+        if (tok == "template") {
+            // Skip the parameter list, whose class keywords declare no types
+            size_t j = i + 1;
+            int depth = 0;
+            for (; j < tokens.size(); ++j) {
+                if (tokens[j] == "<") ++depth;
+                if (tokens[j] == ">" && --depth == 0) break;
+            }
+            i = j;
+            continue;
+        }
+        if (tok == "[" && i + 1 < tokens.size() && tokens[i + 1] == "[") {
+            // Attributes
+            size_t j = i + 2;
+            while (j + 1 < tokens.size() && !(tokens[j] == "]" && tokens[j + 1] == "]")) ++j;
+            i = j + 1;
+            continue;
+        }
+        if (tok == "using" && last_ident.empty()) {
+            size_t end = statement_end(i);
+            if (i + 1 < tokens.size() && tokens[i + 1] == "namespace") {
+                // Leaks into every source included after this one
+                names.using_directives.insert(qualified("") + ":" + join(i + 2, end));
+            } else if (i + 2 < tokens.size() && is_identifier(tokens[i + 1]) && tokens[i + 2] == "=") {
+                names.aliases[qualified(tokens[i + 1])] = join(i + 3, end);
+            } else if (end > i + 1 && is_identifier(tokens[end - 1])) {
+                // A using-declaration brings a name in like a declaration would
+                names.external.insert(qualified(tokens[end - 1]));
+            }
+            i = end;
+            reset();
+            continue;
+        }
+        if (tok == "typedef" && last_ident.empty()) {
+            // typedef old new;  or  typedef ret (*new)(args);
+            size_t end = statement_end(i);
+            size_t name = end;
+            for (size_t j = i + 1; j < end; ++j) {
+                if (tokens[j] == "(") {
+                    name = end;
+                    for (size_t k = j + 1; k < end && name == end; ++k) {
+                        if (is_identifier(tokens[k])) name = k;
+                    }
+                    break;
+                }
+                if (is_identifier(tokens[j])) name = j;
+            }
+            if (name < end) {
+                names.aliases[qualified(tokens[name])] = join(i + 1, name) + " _ " + join(name + 1, end);
+            }
+            i = end;
+            reset();
+            continue;
+        }
+
+        if (tok == ";") {
+            // "struct Name;" only declares the type
+            if (type_name.empty() || last_ident != type_name) record(false);
+            reset();
+        } else if (tok == "(") {
+            record(true);
+        } else if (tok == "=" || tok == "[") {
+            record(false);
+        } else if (tok == ":" && !type_name.empty()) {
+            in_bases = true;
+        } else if (tok == "*" || tok == "&") {
+            // const before a pointer applies to what it points at
+            is_const = false;
+        } else if (tok == "static") {
+            is_static = true;
+        } else if (tok == "extern") {
+            is_extern = true;
+        } else if (tok == "inline") {
+            is_inline = true;
+        } else if (tok == "const" || tok == "constexpr") {
+            is_const = true;
+        } else if ((tok == "class" || tok == "struct" || tok == "union" || tok == "enum") && last_ident.empty()) {
+            if (tok == "enum") {
+                is_enum = true;
+            } else if (is_enum) {
+                scoped_enum = true;
+            }
+            if (i + 1 < tokens.size() && is_identifier(tokens[i + 1]) && tokens[i + 1] != "class" && tokens[i + 1] != "struct") {
+                type_name = tokens[i + 1];
+            }
+        } else if (is_identifier(tok) && !statement_done && !in_bases && tok != "final") {
+            // Keep the qualifier of an out-of-line member such as Class::name
+            bool member = i > 1 && tokens[i - 1] == "::" && tokens[i - 2] == last_ident;
+            last_ident = member ? last_ident + "::" + tok : tok;
+        }
+    }
+    // A definition without static repeats an earlier static declaration
+    for (const auto& name : names.internal) {
+        names.external.erase(name);
+    }
+    return names;
+}
+
+// Whether source names something another source defines differently, or
+// defines a macro another source mentions. Both sources of an internal name
+// clash, while an external name only clashes with an internal one, whose
+// source is kept out of unity files already.
+static std::string collision(const SourceNames& source, const std::map<std::string, int>& internal_count,
+    const std::map<std::string, int>& external_count, const std::map<std::string, std::set<std::string>>& alias_targets,
+    const std::map<std::string, int>& mention_count
+) {
+    auto count = [](const std::map<std::string, int>& counts, const std::string& name) {
+        auto it = counts.find(name);
+        return it == counts.end() ? 0 : it->second;
+    };
+    auto aliased = [&](const std::string& name) {
+        auto it = alias_targets.find(name);
+        return it == alias_targets.end() ? 0 : static_cast<int>(it->second.size());
+    };
+    for (const auto& name : source.internal) {
+        if (count(internal_count, name) + count(external_count, name) + aliased(name) > 1) return name;
+    }
+    for (const auto& alias : source.aliases) {
+        // Repeating an alias for the same thing is allowed
+        if (aliased(alias.first) > 1 || count(internal_count, alias.first) + count(external_count, alias.first) > 0) {
+            return alias.first;
+        }
+    }
+    for (const auto& macro : source.macros) {
+        if (count(mention_count, macro) > 1) return "#define " + macro;
+    }
+    return "";
+}
+
+std::vector<CompileUnit> make_unity_units(const std::vector<CompileUnit>& units,
+    const std::string& build_dir,
+    int batch_size,
+    const std::vector<std::string>& exclude
+) {
+    if (batch_size < 2) {
+        return units;
+    }
+
+    // Count how many sources declare or mention each name
+    std::vector<SourceNames> unit_names;
+    std::map<std::string, int> internal_count, external_count, mention_count;
+    std::map<std::string, std::set<std::string>> alias_targets;
+    for (const auto& unit : units) {
+        unit_names.push_back(source_names(unit.source));
+        const SourceNames& names = unit_names.back();
+        for (const auto& name : names.internal) internal_count[name]++;
+        for (const auto& name : names.external) external_count[name]++;
+        for (const auto& alias : names.aliases) alias_targets[alias.first].insert(alias.second);
+        std::set<std::string> mentioned = names.identifiers;
+        mentioned.insert(names.macros.begin(), names.macros.end());
+        for (const auto& name : mentioned) mention_count[name]++;
+    }
+
+    std::vector<CompileUnit> result;
+    // Sources share a chunk only with the same flags, extension and using-directives
+    std::map<std::string, std::vector<CompileUnit>> groups;
+    for (size_t i = 0; i < units.size(); ++i) {
+        const CompileUnit& unit = units[i];
+        bool excluded = false;
+        for (const auto& path : exclude) {
+            std::error_code ec;
+            if (path == unit.source || fs::equivalent(path, unit.source, ec)) {
+                excluded = true;
+            }
+        }
+        std::string name = excluded ? "" : collision(unit_names[i], internal_count, external_count, alias_targets, mention_count);
+        if (!name.empty()) {
+            std::cout << "⚠️ Unity: compiling " << unit.source << " alone ('" << name << "' collides with another source)\n";
+            excluded = true;
+        }
+        if (excluded) {
+            result.push_back(unit);
+            continue;
+        }
+        std::string key = fs::path(unit.source).extension().string();
+        for (const auto& flag : unit.flags) key += "\n" + flag;
+        for (const auto& directive : unit_names[i].using_directives) key += "\nusing " + directive;
+        groups[key].push_back(unit);
+    }
+
+    std::string unity_dir = build_dir + "unity/";
+    fs::create_directories(unity_dir);
+
+    // A chunk ends after a source whose path hashes to a boundary, about one
+    // in batch_size / 2, or once it is full. Chunks away from a change keep
+    // their members, unlike chunks cut every batch_size sources.
+    std::vector<std::vector<CompileUnit>> chunks;
+    unsigned long boundary = std::max(batch_size / 2, 2);
+    for (auto& group : groups) {
+        std::vector<CompileUnit>& members = group.second;
+        std::sort(members.begin(), members.end(), [](const CompileUnit& a, const CompileUnit& b) {
+            return a.source < b.source;
+        });
+        std::vector<CompileUnit> chunk;
+        for (const auto& unit : members) {
+            chunk.push_back(unit);
+            bool cut = std::stoul(content_hash(unit.source).substr(0, 8), nullptr, 16) % boundary == 0;
+            if (cut || chunk.size() >= static_cast<size_t>(batch_size)) {
+                chunks.push_back(chunk);
+                chunk.clear();
+            }
+        }
+        if (!chunk.empty()) chunks.push_back(chunk);
+    }
+
+    std::set<std::string> chunk_names;
+    for (const auto& chunk : chunks) {
+        if (chunk.size() == 1) {
+            result.push_back(chunk.front());
+            continue;
+        }
+
+        std::string contents = "// Generated by jmakepp, do not edit\n";
+        for (const auto& unit : chunk) {
+            contents += "#include \"" + fs::absolute(unit.source).generic_string() + "\"\n";
+        }
+        // Named after its members, so an existing file is already up to date
+        std::string name = "unity_" + content_hash(contents).substr(0, 8);
+        std::string unity_source = unity_dir + name + fs::path(chunk.front().source).extension().string();
+        chunk_names.insert(name);
+        if (!fs::exists(unity_source)) {
+            std::ofstream out(unity_source, std::ios::trunc);
+            out << contents;
+        }
+
+        result.push_back({unity_source, unity_dir + name + ".o", chunk.front().flags, {}});
+    }
+
+    // Drop the sources and objects of chunks that are gone
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(unity_dir, ec)) {
+        std::string file = entry.path().filename().string();
+        if (file.rfind("unity_", 0) == 0 && !chunk_names.count(file.substr(0, file.find('.')))) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,147 @@
+#include "../include/dauser/watch.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/buildlock.hpp"
+#include "../include/dauser/config.hpp"
+#include "../include/dauser/depscan.hpp"
+#include "../include/dauser/filecache.hpp"
+#include "../include/dauser/platform.hpp"
+#include "../include/dauser/watcher.hpp"
+#include <iostream>
+
+#ifndef __linux__
+
+int watch_project(bool) {
+    std::cerr << "❌ jmakepp watch is only supported on Linux\n";
+    return 1;
+}
+
+#else
+
+#include <csignal>
+#include <filesystem>
+#include <poll.h>
+#include <set>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static std::string normalize(const fs::path& path) {
+    return fs::absolute(path).lexically_normal().string();
+}
+
+// project.json, every source and every header they include
+static std::set<std::string> build_graph_files() {
+    std::set<std::string> files = {normalize("project.json")};
+    json config = load_project_config();
+    for (const auto& target : project_targets(config)) {
+        json settings = target_config(config, target);
+        std::vector<std::string> includepaths = settings.value("includepaths", std::vector<std::string>{"./include/*"});
+        IncludeScanner scanner(expand_includes(includepaths));
+        for (const auto& src : project_sources(settings)) {
+            files.insert(normalize(src));
+            for (const auto& header : scanner.dependencies(src)) {
+                files.insert(header);
+            }
+        }
+    }
+    return files;
+}
+
+static pid_t start_binary(const std::string& path) {
+    std::cout << "🚀 Running: " << path << "\n";
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(path.c_str(), path.c_str(), static_cast<char*>(nullptr));
+        std::perror(path.c_str());
+        _exit(127);
+    }
+    return pid;
+}
+
+static void stop_binary(pid_t& pid) {
+    if (pid <= 0) {
+        return;
+    }
+    int status;
+    if (waitpid(pid, &status, WNOHANG) == 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+    }
+    pid = -1;
+}
+
+int watch_project(bool run) {
+    FileWatcher watcher;
+    if (!watcher.ok()) {
+        std::cerr << "❌ inotify is not available\n";
+        return 1;
+    }
+
+    // Changes reported while a build runs are kept so they trigger the next one
+    std::vector<std::string> pending;
+    bool overflow = false;
+    enable_file_cache([&](const std::string& dir) { return watcher.add(dir); }, [&]() {
+        bool lost;
+        std::vector<std::string> changed = watcher.drain(lost);
+        pending.insert(pending.end(), changed.begin(), changed.end());
+        overflow = overflow || lost;
+    });
+
+    int debounce_ms = 200;
+    pid_t child = -1;
+    while (true) {
+        std::set<std::string> graph;
+        try {
+            json config = load_project_config();
+            debounce_ms = config.value("watch debounce", 200);
+            stop_binary(child);
+            std::string target = run ? run_target(config, "") : "";
+            bool ok = coalesced_build({"", "", "", ""});
+            if (ok && run) {
+                child = start_binary(output_path(target_config(config, target), host_platform(), config["version"],
+                    selected_variant(config, "")));
+            }
+            graph = build_graph_files();
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Exception: " << e.what() << "\n";
+            graph = {normalize("project.json")};
+        }
+        for (const auto& file : graph) {
+            watch_directory(fs::path(file).parent_path().string());
+        }
+        std::cout << "👀 Watching " << graph.size() << " file(s) for changes...\n";
+
+        // Wait for a change to the build graph, then for the burst of saves to settle
+        std::string trigger;
+        while (true) {
+            sync_file_cache();
+            for (const auto& path : pending) {
+                if (graph.count(path)) {
+                    trigger = path;
+                    break;
+                }
+            }
+            pending.clear();
+            if (overflow) {
+                trigger = trigger.empty() ? "(events lost)" : trigger;
+                overflow = false;
+            }
+            if (!trigger.empty()) {
+                break;
+            }
+            pollfd fd = {watcher.fd(), POLLIN, 0};
+            poll(&fd, 1, -1);
+        }
+        pollfd fd = {watcher.fd(), POLLIN, 0};
+        while (poll(&fd, 1, debounce_ms) > 0) {
+            sync_file_cache();
+        }
+        pending.clear();
+        overflow = false;
+        std::cout << "🔁 Changed: " << trigger << ", rebuilding\n";
+    }
+}
+
+#endif
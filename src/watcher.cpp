@@ -0,0 +1,90 @@
+#include "../include/dauser/watcher.hpp"
+#include "../include/dauser/filecache.hpp"
+
+#ifdef __linux__
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+FileWatcher::FileWatcher() {
+    notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileWatcher::~FileWatcher() {
+    if (notify >= 0) {
+        close(notify);
+    }
+}
+
+bool FileWatcher::ok() const {
+    return notify >= 0;
+}
+
+int FileWatcher::fd() const {
+    return notify;
+}
+
+bool FileWatcher::add(const std::string& dir) {
+    if (notify < 0) {
+        return false;
+    }
+    int wd = inotify_add_watch(notify, dir.c_str(),
+        IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE |
+        IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+    if (wd < 0) {
+        return false;
+    }
+    watches[wd] = dir;
+    return true;
+}
+
+std::vector<std::string> FileWatcher::drain(bool& overflow) {
+    std::vector<std::string> changed;
+    overflow = false;
+    if (notify < 0) {
+        return changed;
+    }
+    alignas(inotify_event) char buffer[16384];
+    ssize_t n;
+    while ((n = read(notify, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + n;) {
+            auto* event = reinterpret_cast<inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                if (event->mask & IN_IGNORED) {
+                    watches.erase(event->wd);
+                }
+                invalidate_file_cache();
+                overflow = true;
+                continue;
+            }
+            auto it = watches.find(event->wd);
+            if (it == watches.end() || event->len == 0) {
+                continue;
+            }
+            std::string path = it->second + "/" + event->name;
+            invalidate_file(path);
+            changed.push_back(path);
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))) {
+                // Files cached below a replaced directory are unwatched now
+                invalidate_file_cache();
+                overflow = true;
+            }
+        }
+    }
+    return changed;
+}
+
+#else
+
+FileWatcher::FileWatcher() {}
+FileWatcher::~FileWatcher() {}
+bool FileWatcher::ok() const { return false; }
+int FileWatcher::fd() const { return -1; }
+bool FileWatcher::add(const std::string&) { return false; }
+std::vector<std::string> FileWatcher::drain(bool& overflow) {
+    overflow = false;
+    return {};
+}
+
+#endif
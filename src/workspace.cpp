@@ -0,0 +1,82 @@
+#include "../include/dauser/workspace.hpp"
+#include "../include/dauser/builder.hpp"
+#include "../include/dauser/buildlock.hpp"
+#include "../include/dauser/config.hpp"
+#include "../include/dauser/filecache.hpp"
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+// Members needed for a request, each after the members in its "depends"
+static std::vector<std::string> member_build_order(const json& workspace, const std::vector<std::string>& requested) {
+    const json& members = workspace["members"];
+    std::vector<std::string> order;
+    std::map<std::string, int> state; // 1 while visiting, 2 once ordered
+    std::function<void(const std::string&)> visit = [&](const std::string& member) {
+        if (!members.contains(member)) {
+            throw std::runtime_error("unknown workspace member '" + member + "', add it to \"members\" in workspace.json");
+        }
+        if (state[member] == 2) return;
+        if (state[member] == 1) {
+            throw std::runtime_error("workspace member '" + member + "' depends on itself");
+        }
+        state[member] = 1;
+        for (const auto& dep : members[member].value("depends", std::vector<std::string>{})) {
+            visit(dep);
+        }
+        state[member] = 2;
+        order.push_back(member);
+    };
+    if (requested.empty()) {
+        for (const auto& entry : members.items()) {
+            visit(entry.key());
+        }
+    } else {
+        for (const auto& member : requested) {
+            visit(member);
+        }
+    }
+    return order;
+}
+
+bool build_workspace(const std::vector<std::string>& members, const std::string& variant) {
+    std::string text;
+    if (!read_file_cached("workspace.json", text)) {
+        throw std::runtime_error("workspace.json not found.");
+    }
+    json workspace = json::parse(text);
+    if (!workspace.contains("members")) {
+        throw std::runtime_error("workspace.json has no \"members\"");
+    }
+    int max_threads = workspace.value("max threads", static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<std::string> order = member_build_order(workspace, members);
+    std::cout << "🗂️ Workspace: building " << order.size() << " of " << workspace["members"].size() << " member(s)\n";
+
+    // Members are loaded only now, once it is known they are needed
+    std::vector<json> configs;
+    std::vector<std::string> buildpaths;
+    for (const auto& member : order) {
+        std::string dir = workspace["members"][member].value("path", member);
+        configs.push_back(rebase_config(load_project_config(dir), dir));
+        buildpaths.push_back(variant_buildpath(configs.back(), selected_variant(configs.back(), variant)));
+    }
+    // Hold every member's build lock, as jmakepp build in a member would
+    BuildLocks locks(buildpaths);
+
+    BuildPlan plan;
+    std::map<std::string, std::vector<PlannedLink>> links;
+    BuildOptions options;
+    options.variant = variant;
+    for (size_t n = 0; n < order.size(); ++n) {
+        const json& entry = workspace["members"][order[n]];
+        const json& config = configs[n];
+        std::vector<PlannedLink> external;
+        for (const auto& dep : entry.value("depends", std::vector<std::string>{})) {
+            external.insert(external.end(), links[dep].begin(), links[dep].end());
+        }
+        links[order[n]] = plan_project(plan, config, options, config["version"], order[n], external);
+    }
+    return run_plan(plan, max_threads);
+}
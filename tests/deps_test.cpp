@@ -0,0 +1,37 @@
+#include "test.hpp"
+#include "../include/dauser/deps.hpp"
+#include "../include/dauser/filio.hpp"
+
+TEST(depfile_lists_prerequisites) {
+    std::string dir = test_dir("depfile_lists_prerequisites");
+    filio::write(dir + "a.d", "obj/a.o: src/a.cpp include/a.hpp \\\n  include/b.hpp\n");
+    std::vector<std::string> deps = read_depfile(dir + "a.d");
+    CHECK((deps == std::vector<std::string>{"src/a.cpp", "include/a.hpp", "include/b.hpp"}));
+}
+
+TEST(depfile_keeps_escaped_spaces) {
+    std::string dir = test_dir("depfile_keeps_escaped_spaces");
+    filio::write(dir + "a.d", "a.o: my\\ dir/a.cpp \\#odd.hpp\r\n");
+    std::vector<std::string> deps = read_depfile(dir + "a.d");
+    CHECK((deps == std::vector<std::string>{"my dir/a.cpp", "#odd.hpp"}));
+}
+
+TEST(depfile_handles_crlf_continuations) {
+    std::string dir = test_dir("depfile_handles_crlf_continuations");
+    filio::write(dir + "a.d", "a.o: a.cpp \\\r\n a.hpp\r\n");
+    std::vector<std::string> deps = read_depfile(dir + "a.d");
+    CHECK((deps == std::vector<std::string>{"a.cpp", "a.hpp"}));
+}
+
+TEST(depfile_stops_at_phony_targets) {
+    // -MP adds an empty rule per header after the real one
+    std::string dir = test_dir("depfile_stops_at_phony_targets");
+    filio::write(dir + "a.d", "a.o: a.cpp a.hpp\n\na.hpp:\n");
+    std::vector<std::string> deps = read_depfile(dir + "a.d");
+    CHECK((deps == std::vector<std::string>{"a.cpp", "a.hpp"}));
+}
+
+TEST(depfile_missing_is_empty) {
+    std::string dir = test_dir("depfile_missing_is_empty");
+    CHECK(read_depfile(dir + "missing.d").empty());
+}
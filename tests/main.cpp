@@ -0,0 +1,55 @@
+#include "test.hpp"
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    int failures = 0;
+}
+
+std::vector<std::pair<std::string, std::function<void()>>>& test_cases() {
+    static std::vector<std::pair<std::string, std::function<void()>>> cases;
+    return cases;
+}
+
+void test_failure(const char* file, int line, const char* condition) {
+    std::cout << "   ❌ " << file << ":" << line << ": " << condition << "\n";
+    ++failures;
+}
+
+std::string test_dir(const std::string& name) {
+    fs::path dir = fs::temp_directory_path() / "jmakepp-tests" / name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir.string() + "/";
+}
+
+// jmakepp_tests [name...] runs the named tests, or all of them
+int main(int argc, char* argv[]) {
+    int failed_tests = 0;
+    int run = 0;
+    for (const auto& test : test_cases()) {
+        bool wanted = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            if (test.first == argv[i]) wanted = true;
+        }
+        if (!wanted) continue;
+        int before = failures;
+        try {
+            test.second();
+        } catch (const std::exception& e) {
+            std::cout << "   ❌ threw: " << e.what() << "\n";
+            ++failures;
+        }
+        ++run;
+        if (failures != before) {
+            ++failed_tests;
+            std::cout << "❌ " << test.first << "\n";
+        } else {
+            std::cout << "✅ " << test.first << "\n";
+        }
+    }
+    std::cout << (failed_tests == 0 ? "✅ " : "❌ ") << run - failed_tests << " of " << run << " test(s) passed\n";
+    return failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include "test.hpp"
+#include "../include/dauser/cmd.hpp"
+#include "../include/dauser/filio.hpp"
+#include "../include/dauser/multiarch.hpp"
+
+#if defined(__linux__) && defined(__x86_64__)
+
+TEST(multiarch_constructs_globals_once) {
+    // Level builds share the baseline's globals, so only the baseline may
+    // construct and destroy them
+    std::string dir = test_dir("multiarch_constructs_globals_once");
+    filio::write(dir + "noisy.cpp",
+        "#include <cstdio>\n"
+        "#include <string>\n"
+        "struct Noisy {\n"
+        "    Noisy() { std::printf(\"construct %p\\n\", static_cast<void*>(this)); }\n"
+        "    ~Noisy() { std::printf(\"destroy\\n\"); }\n"
+        "};\n"
+        "Noisy noisy;\n"
+        "std::string name = std::string(64, 'x');\n"
+        "int sum(const int* values, int count) {\n"
+        "    static std::string last = name;\n"
+        "    int total = 0;\n"
+        "    for (int n = 0; n < count; ++n) total += values[n];\n"
+        "    return total + static_cast<int>(name.size() + last.size());\n"
+        "}\n");
+    filio::write(dir + "main.cpp",
+        "int sum(const int* values, int count);\n"
+        "int main() { int values[] = {1, 2, 3}; return sum(values, 3) == 134 ? 0 : 1; }\n");
+    std::vector<std::string> levels = {"x86-64-v2", "x86-64-v3"};
+    std::string object = dir + "noisy.o";
+    CHECK(run_cmd("g++ -c -fPIC -O2 -o " + object + " " + dir + "noisy.cpp") == 0);
+    for (const auto& level : levels) {
+        CHECK(run_cmd("g++ -c -fPIC -O2 -march=" + level + " -o " + level_object(object, level) + " " + dir + "noisy.cpp") == 0);
+    }
+    CHECK(build_multiarch(object, levels, "g++") == 0);
+
+    MultiarchObjects objects = multiarch_objects(object, levels);
+    std::string link = "g++ -o " + dir + "program " + dir + "main.cpp";
+    for (const auto& input : objects.first) link += " " + input;
+    for (const auto& input : objects.last) link += " " + input;
+    CHECK(run_cmd(link) == 0);
+
+    std::string output;
+    CHECK(capture_cmd(dir + "program", output) == 0);
+    size_t constructed = 0;
+    for (size_t at = output.find("construct"); at != std::string::npos; at = output.find("construct", at + 1)) {
+        ++constructed;
+    }
+    CHECK(constructed == 1);
+    CHECK(output.find("destroy") != std::string::npos && output.find("destroy") == output.rfind("destroy"));
+}
+
+TEST(multiarch_refuses_constructed_statics) {
+    // Level builds would use their own copy of cache without constructing it
+    std::string dir = test_dir("multiarch_refuses_constructed_statics");
+    filio::write(dir + "cache.cpp",
+        "#include <string>\n"
+        "static std::string cache = std::string(5, 'c');\n"
+        "int cached() { return static_cast<int>(cache.size()); }\n");
+    std::vector<std::string> levels = {"x86-64-v3"};
+    std::string object = dir + "cache.o";
+    CHECK(run_cmd("g++ -c -fPIC -O2 -o " + object + " " + dir + "cache.cpp") == 0);
+    CHECK(run_cmd("g++ -c -fPIC -O2 -march=x86-64-v3 -o " + level_object(object, levels[0]) + " " + dir + "cache.cpp") == 0);
+    CHECK(build_multiarch(object, levels, "g++") != 0);
+}
+
+#endif
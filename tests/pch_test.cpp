@@ -0,0 +1,68 @@
+#include "test.hpp"
+#include "../include/dauser/filio.hpp"
+#include "../include/dauser/pch.hpp"
+#include "../include/dauser/scheduler.hpp"
+#include <chrono>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Two sources that both include inc/a.hpp
+    std::vector<CompileUnit> pch_project(const std::string& dir) {
+        fs::create_directories(dir + "inc");
+        filio::write(dir + "inc/a.hpp", "#pragma once\ninline int a() { return 1; }\n");
+        filio::write(dir + "f.cpp", "#include \"a.hpp\"\nint f() { return a(); }\n");
+        filio::write(dir + "g.cpp", "#include \"a.hpp\"\nint g() { return a() + 1; }\n");
+        std::vector<std::string> flags = {"-std=c++17"};
+        return {{dir + "f.cpp", dir + "f.o", flags}, {dir + "g.cpp", dir + "g.o", flags}};
+    }
+
+    // Move a file's time back, so files written next are clearly newer
+    void age(const std::string& path) {
+        fs::last_write_time(path, fs::last_write_time(path) - std::chrono::seconds(5));
+    }
+
+    size_t stale_units(const std::vector<CompileUnit>& units, const std::vector<std::string>& includes) {
+        JobGraph graph;
+        size_t stale = 0;
+        for (size_t job : add_compile_jobs(graph, units, "g++", includes, 1, 1)) {
+            if (job != JobGraph::none) ++stale;
+        }
+        return stale;
+    }
+}
+
+TEST(pch_edit_recompiles_users) {
+    std::string dir = test_dir("pch_edit_recompiles_users");
+    std::vector<CompileUnit> units = pch_project(dir);
+    std::vector<std::string> includes = {"-I" + dir + "inc"};
+    std::string header = prepare_pch(dir + "inc/a.hpp", units, "g++", {"-std=c++17"}, includes, dir, false, 0.5);
+    CHECK(!header.empty());
+    for (auto& unit : units) use_pch(unit, header);
+    std::vector<int> results = compile_all(units, "g++", includes, 1, 1);
+    CHECK((results == std::vector<int>{0, 0}));
+    CHECK(stale_units(units, includes) == 0);
+
+    // The users' depfiles do not name a.hpp, only the rebuilt .gch tells them
+    for (const auto& file : {header + ".gch", dir + "f.o", dir + "g.o"}) age(file);
+    filio::write(dir + "inc/a.hpp", "#pragma once\ninline int a() { return 7; }\n");
+    CHECK(prepare_pch(dir + "inc/a.hpp", units, "g++", {"-std=c++17"}, includes, dir, false, 0.5) == header);
+    CHECK(stale_units(units, includes) == 2);
+}
+
+TEST(pch_auto_selection_survives_pch_builds) {
+    std::string dir = test_dir("pch_auto_selection_survives_pch_builds");
+    std::vector<CompileUnit> units = pch_project(dir);
+    std::vector<std::string> includes = {"-I" + dir + "inc"};
+    std::string header = prepare_pch("auto", units, "g++", {"-std=c++17"}, includes, dir, false, 0.5);
+    CHECK(!header.empty());
+    std::vector<CompileUnit> users = units;
+    for (auto& unit : users) use_pch(unit, header);
+    CHECK((compile_all(users, "g++", includes, 1, 1) == std::vector<int>{0, 0}));
+
+    // The users' depfiles now leave out a.hpp, which must still be selected
+    std::vector<std::string> hot = hot_headers(units, includes, 0.5, header);
+    CHECK(hot.size() == 1 && fs::path(hot.front()).filename() == "a.hpp");
+    CHECK(prepare_pch("auto", units, "g++", {"-std=c++17"}, includes, dir, false, 0.5) == header);
+}
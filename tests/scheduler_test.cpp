@@ -0,0 +1,157 @@
+#include "test.hpp"
+#include "../include/dauser/linker.hpp"
+#include "../include/dauser/scheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace {
+    void pause() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    // Threads in use by running jobs, and the most seen at once
+    struct Usage {
+        std::mutex mutex;
+        int now = 0;
+        int peak = 0;
+
+        std::function<int()> job(int weight) {
+            return [this, weight]() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    now += weight;
+                    if (now > peak) peak = now;
+                }
+                pause();
+                std::lock_guard<std::mutex> lock(mutex);
+                now -= weight;
+                return 0;
+            };
+        }
+    };
+}
+
+TEST(jobs_wait_for_their_prerequisites) {
+    JobGraph graph;
+    std::mutex mutex;
+    std::vector<size_t> order;
+    auto job = [&](size_t id) {
+        return [&, id]() {
+            pause();
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+            return 0;
+        };
+    };
+    size_t a = graph.add(job(0));
+    size_t b = graph.add(job(1));
+    size_t c = graph.add(job(2), {a, b});
+    size_t d = graph.add(job(3), {c, JobGraph::none});
+    std::vector<int> results = graph.run(4);
+    CHECK((results == std::vector<int>{0, 0, 0, 0}));
+    CHECK(order.size() == 4 && order[2] == c && order[3] == d);
+}
+
+TEST(failures_skip_every_dependent) {
+    JobGraph graph;
+    std::atomic<int> ran{0};
+    auto ok = [&]() { ++ran; return 0; };
+    size_t fails = graph.add([&]() { ++ran; return 2; });
+    size_t independent = graph.add(ok);
+    size_t child = graph.add(ok, {fails, independent});
+    size_t grandchild = graph.add(ok, {child});
+    std::vector<int> results = graph.run(2);
+    CHECK(results[fails] == 2);
+    CHECK(results[independent] == 0);
+    CHECK(results[child] == 1);
+    CHECK(results[grandchild] == 1);
+    CHECK(ran == 2);
+}
+
+TEST(cycles_report_failure) {
+    JobGraph graph;
+    bool ran = false;
+    graph.add([&]() { ran = true; return 0; }, {1});
+    graph.add([&]() { ran = true; return 0; }, {0});
+    graph.add([]() { return 0; });
+    std::vector<int> results = graph.run(2);
+    CHECK((results == std::vector<int>{1, 1, 0}));
+    CHECK(!ran);
+}
+
+TEST(weights_stay_within_the_thread_budget) {
+    JobGraph graph;
+    Usage usage;
+    for (int n = 0; n < 6; ++n) graph.add(usage.job(1));
+    graph.add(usage.job(3), {}, 3);
+    for (int n = 0; n < 6; ++n) graph.add(usage.job(1));
+    std::vector<int> results = graph.run(4);
+    CHECK(usage.peak <= 4);
+    CHECK(usage.peak >= 3);
+    for (int result : results) CHECK(result == 0);
+}
+
+TEST(heavy_jobs_are_not_overtaken) {
+    // Light jobs added after a waiting heavy job start only after it
+    JobGraph graph;
+    std::mutex mutex;
+    std::vector<size_t> started;
+    auto job = [&](size_t id) {
+        return [&, id]() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                started.push_back(id);
+            }
+            pause();
+            return 0;
+        };
+    };
+    graph.add(job(0));
+    size_t heavy = graph.add(job(1), {}, 2);
+    for (size_t n = 2; n < 8; ++n) graph.add(job(n));
+    graph.run(2);
+    CHECK(started.size() == 8 && started[1] == heavy);
+}
+
+TEST(heavy_jobs_run_alone_past_the_budget) {
+    // A weight above max_threads takes every thread instead of never running
+    JobGraph graph;
+    Usage usage;
+    graph.add(usage.job(1));
+    graph.add(usage.job(2), {}, 8);
+    graph.add(usage.job(1));
+    std::vector<int> results = graph.run(2);
+    CHECK((results == std::vector<int>{0, 0, 0}));
+    CHECK(usage.peak <= 2);
+}
+
+TEST(links_overlap_other_targets_compiles) {
+    // Target a links while target b, planned after it, still compiles
+    JobGraph graph;
+    std::atomic<int> compiling_b{0};
+    int compiling_at_link = -1;
+    // b's compiles take longer, so some are still running when a's inputs are done
+    auto compile = [](std::atomic<int>* running) {
+        return [running]() {
+            if (running) ++*running;
+            for (int n = 0; n < (running ? 3 : 1); ++n) pause();
+            if (running) --*running;
+            return 0;
+        };
+    };
+    std::vector<size_t> a_objects = {graph.add(compile(nullptr)), graph.add(compile(nullptr))};
+    int weight = linker_weight("mold", default_link_threads("mold", 4));
+    graph.add([&]() { compiling_at_link = compiling_b; pause(); return 0; }, a_objects, weight);
+    for (int n = 0; n < 6; ++n) graph.add(compile(&compiling_b));
+    graph.run(4);
+    CHECK(compiling_at_link > 0);
+    CHECK(default_link_threads("gold", 16) == 1);
+}
+
+TEST(empty_graph_runs) {
+    JobGraph graph;
+    CHECK(graph.run(4).empty());
+    CHECK(graph.size() == 0);
+}
@@ -0,0 +1,32 @@
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Test cases registered with TEST, in the order they were defined
+std::vector<std::pair<std::string, std::function<void()>>>& test_cases();
+
+// Record a failed CHECK of the running test
+void test_failure(const char* file, int line, const char* condition);
+
+// An empty scratch directory for one test, ending in '/'
+std::string test_dir(const std::string& name);
+
+struct TestRegistration {
+    TestRegistration(const std::string& name, std::function<void()> test) {
+        test_cases().push_back({name, test});
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistration name##_registration(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { if (!(condition)) test_failure(__FILE__, __LINE__, #condition); } while (0)
+
+#endif // TEST_HPP
@@ -0,0 +1,183 @@
+#include "test.hpp"
+#include "../include/dauser/filio.hpp"
+#include "../include/dauser/unity.hpp"
+#include <algorithm>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Write sources into dir as units compiled with the same flags
+    std::vector<CompileUnit> write_sources(const std::string& dir,
+        const std::vector<std::pair<std::string, std::string>>& sources
+    ) {
+        std::vector<CompileUnit> units;
+        for (const auto& source : sources) {
+            filio::write(dir + source.first, source.second);
+            units.push_back({dir + source.first, dir + fs::path(source.first).stem().string() + ".o", {"-O2"}, {}});
+        }
+        return units;
+    }
+
+    // Whether make_unity_units compiled source on its own
+    bool alone(const std::vector<CompileUnit>& result, const std::string& source) {
+        return std::any_of(result.begin(), result.end(), [&](const CompileUnit& unit) { return unit.source == source; });
+    }
+
+    std::vector<std::string> chunk_files(const std::string& dir) {
+        std::vector<std::string> files;
+        for (const auto& entry : fs::directory_iterator(dir + "unity/")) {
+            files.push_back(entry.path().filename().string());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+}
+
+TEST(unity_names_by_linkage) {
+    std::string dir = test_dir("unity_names_by_linkage");
+    filio::write(dir + "a.cpp",
+        "static int counter = 0;\n"
+        "namespace { void helper() {} }\n"
+        "namespace app {\n"
+        "const int limit = 3;\n"
+        "const char* label = \"x\";\n"
+        "constexpr double ratio = 0.5;\n"
+        "extern const int shared = 1;\n"
+        "inline const int visible = 2;\n"
+        "enum Color { red, green = 2 };\n"
+        "struct Options : Base { int value; };\n"
+        "struct Forward;\n"
+        "int run(int argc);\n"
+        "}\n"
+        "int Widget::count = 0;\n"
+        "template <class T> T twice(T value) { return value + value; }\n");
+    SourceNames names = source_names(dir + "a.cpp");
+    CHECK(names.internal == (std::set<std::string>{"counter", "helper", "app::limit", "app::ratio",
+        "app::Color", "app::red", "app::green", "app::Options"}));
+    CHECK(names.external == (std::set<std::string>{"app::label", "app::shared", "app::visible", "app::run",
+        "Widget::count", "twice"}));
+}
+
+TEST(unity_names_aliases_macros_and_directives) {
+    std::string dir = test_dir("unity_names_aliases_macros_and_directives");
+    filio::write(dir + "a.cpp",
+        "#define LIMIT 10\n"
+        "#define TEMP(x) \\\n  (x + 1)\n"
+        "#undef TEMP\n"
+        "#ifdef VERBOSE\n#endif\n"
+        "namespace fs = std::filesystem;\n"
+        "using json = nlohmann::json;\n"
+        "typedef void (*callback)(int);\n"
+        "using std::string;\n"
+        "using namespace std;\n");
+    SourceNames names = source_names(dir + "a.cpp");
+    CHECK(names.macros == std::set<std::string>{"LIMIT"});
+    CHECK(names.identifiers.count("VERBOSE") == 1);
+    CHECK(names.aliases.count("fs") == 1);
+    CHECK(names.aliases.count("json") == 1);
+    CHECK(names.aliases.count("callback") == 1);
+    CHECK(names.external.count("string") == 1);
+    CHECK(names.using_directives.size() == 1);
+}
+
+TEST(unity_static_clashes_with_external_name) {
+    std::string dir = test_dir("unity_static_clashes_with_external_name");
+    std::vector<CompileUnit> units = write_sources(dir, {
+        {"a.cpp", "static int foo() { return 1; }\n"},
+        {"b.cpp", "int foo() { return 2; }\n"},
+        {"c.cpp", "int bar() { return 3; }\n"},
+        {"d.cpp", "int baz() { return 4; }\n"}
+    });
+    std::vector<CompileUnit> result = make_unity_units(units, dir, 8, {});
+    CHECK(alone(result, dir + "a.cpp"));
+    CHECK(!alone(result, dir + "b.cpp"));
+}
+
+TEST(unity_const_and_macro_clashes) {
+    std::string dir = test_dir("unity_const_and_macro_clashes");
+    std::vector<CompileUnit> units = write_sources(dir, {
+        {"a.cpp", "const int size = 3;\n"},
+        {"b.cpp", "const int size = 4;\n"},
+        {"c.cpp", "#define check(x) assert(x)\n"},
+        {"d.cpp", "bool check(int value) { return value > 0; }\n"},
+        {"e.cpp", "#define UNUSED_HERE 1\n"},
+        {"f.cpp", "int f() { return 0; }\n"}
+    });
+    std::vector<CompileUnit> result = make_unity_units(units, dir, 8, {});
+    CHECK(alone(result, dir + "a.cpp"));
+    CHECK(alone(result, dir + "b.cpp"));
+    CHECK(alone(result, dir + "c.cpp"));
+    CHECK(!alone(result, dir + "d.cpp"));
+    CHECK(!alone(result, dir + "e.cpp"));
+}
+
+TEST(unity_alias_repeats_are_allowed) {
+    std::string dir = test_dir("unity_alias_repeats_are_allowed");
+    std::vector<CompileUnit> units = write_sources(dir, {
+        {"a.cpp", "namespace fs = std::filesystem;\n"},
+        {"b.cpp", "namespace fs = std::filesystem;\n"},
+        {"c.cpp", "using id = int;\n"},
+        {"d.cpp", "using id = long;\n"}
+    });
+    std::vector<CompileUnit> result = make_unity_units(units, dir, 8, {});
+    CHECK(!alone(result, dir + "a.cpp"));
+    CHECK(!alone(result, dir + "b.cpp"));
+    CHECK(alone(result, dir + "c.cpp"));
+    CHECK(alone(result, dir + "d.cpp"));
+}
+
+TEST(unity_groups_by_using_directives) {
+    std::string dir = test_dir("unity_groups_by_using_directives");
+    std::vector<CompileUnit> units = write_sources(dir, {
+        {"a.cpp", "using namespace std;\nint a() { return 1; }\n"},
+        {"b.cpp", "int b() { return 2; }\n"},
+        {"c.cpp", "using namespace std;\nint c() { return 3; }\n"},
+        {"d.cpp", "int d() { return 4; }\n"}
+    });
+    std::vector<CompileUnit> result = make_unity_units(units, dir, 8, {});
+    CHECK(result.size() == 2);
+    for (const auto& unit : result) {
+        std::string contents = filio::read(unit.source);
+        bool with_directive = contents.find("a.cpp") != std::string::npos;
+        CHECK(with_directive == (contents.find("c.cpp") != std::string::npos));
+        CHECK(with_directive != (contents.find("b.cpp") != std::string::npos));
+    }
+}
+
+TEST(unity_chunks_survive_added_sources) {
+    std::string dir = test_dir("unity_chunks_survive_added_sources");
+    std::vector<std::pair<std::string, std::string>> sources;
+    for (int n = 0; n < 40; ++n) {
+        std::string name = "s" + std::to_string(100 + n);
+        sources.push_back({name + ".cpp", "int " + name + "() { return 0; }\n"});
+    }
+    std::vector<CompileUnit> units = write_sources(dir, sources);
+    std::vector<CompileUnit> before = make_unity_units(units, dir, 8, {});
+    std::vector<std::string> files_before = chunk_files(dir);
+
+    // A new source in the middle keeps most chunks and their objects
+    std::vector<CompileUnit> added = write_sources(dir, {{"s119a.cpp", "int s119a() { return 0; }\n"}});
+    units.insert(units.begin() + 20, added.front());
+    std::vector<CompileUnit> after = make_unity_units(units, dir, 8, {});
+    size_t kept = 0;
+    for (const auto& unit : after) {
+        for (const auto& old : before) {
+            if (unit.source == old.source) ++kept;
+        }
+    }
+    CHECK(kept + 2 >= before.size());
+
+    // Stale chunks are removed, current ones are on disk
+    std::vector<std::string> files_after = chunk_files(dir);
+    for (const auto& unit : after) {
+        if (unit.source.find("/unity/") != std::string::npos) {
+            CHECK(std::find(files_after.begin(), files_after.end(), fs::path(unit.source).filename().string()) != files_after.end());
+        }
+    }
+    size_t chunks_after = std::count_if(after.begin(), after.end(), [](const CompileUnit& unit) {
+        return unit.source.find("/unity/") != std::string::npos;
+    });
+    CHECK(files_after.size() == chunks_after);
+    CHECK(files_before != files_after);
+}